@@ -0,0 +1,307 @@
+/**
+ * File: clock_bench.c
+ * Author: Brad Waggle
+ * Description: Read cost, granularity, monotonicity and cross-core
+ *              agreement of every clock, to pick one per platform.
+ * Date: October 18, 2026
+ */
+
+// Every clock the kernel offers (REALTIME, MONOTONIC, MONOTONIC_RAW, the
+// COARSE variants, BOOTTIME, TAI, process and thread CPU time) and the
+// calibrated cycle counter of rt_cycles.h are measured the same way:
+//
+//   cost        mean ns per read, best of CLOCK_BATCHES batches so a
+//               preemption in one batch does not count
+//   step        smallest non-zero change between back-to-back reads, the
+//               granularity a caller actually sees, next to clock_getres()
+//   repeats     back-to-back reads that returned the same time, reads
+//               go on for CLOCK_STEP_MIN_MS at least to see a coarse tick
+//   backwards   back-to-back reads on each core that went back in time,
+//               and the worst of them
+//   cross-core  two threads on different cores take turns reading and
+//               publishing their time; a read earlier than the time the
+//               other core published before handing over is a violation.
+//               Every core is paired with the first one. CPU time clocks
+//               are per thread or per process and are not compared.
+//
+// A table goes to the screen and -c writes the same numbers as CSV.
+//
+// Usage: clock_bench [-n reads] [-r rounds] [-c out.csv]
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/sysinfo.h>
+#include "rt_time.h"
+#include "rt_cycles.h"
+
+#define DEFAULT_READS (1000000)
+#define DEFAULT_ROUNDS (100000)
+#define CLOCK_BATCHES (5)
+#define CLOCK_STEP_MIN_MS (20)
+
+typedef struct
+{
+    const char *name;
+    clockid_t id;
+    int cycles;                         // read rt_cycles_now() instead
+    int cross;                          // same time on every core, worth comparing
+} clock_def_t;
+
+static const clock_def_t clocks[] = {
+    { "REALTIME", CLOCK_REALTIME, 0, 1 },
+    { "MONOTONIC", CLOCK_MONOTONIC, 0, 1 },
+    { "MONOTONIC_RAW", CLOCK_MONOTONIC_RAW, 0, 1 },
+    { "REALTIME_COARSE", CLOCK_REALTIME_COARSE, 0, 1 },
+    { "MONOTONIC_COARSE", CLOCK_MONOTONIC_COARSE, 0, 1 },
+    { "BOOTTIME", CLOCK_BOOTTIME, 0, 1 },
+    { "TAI", CLOCK_TAI, 0, 1 },
+    { "PROCESS_CPUTIME", CLOCK_PROCESS_CPUTIME_ID, 0, 0 },
+    { "THREAD_CPUTIME", CLOCK_THREAD_CPUTIME_ID, 0, 0 },
+    { "cycles", CLOCK_MONOTONIC, 1, 1 },
+};
+
+#define NUM_CLOCKS ((int)(sizeof(clocks) / sizeof(clocks[0])))
+
+typedef struct
+{
+    rt_ns_t res_ns;
+    double read_ns;
+    rt_ns_t step_ns;
+    double repeat_pct;
+    unsigned long long backwards;
+    rt_ns_t worst_backwards_ns;
+    unsigned long long cross_rounds;
+    unsigned long long cross_violations;
+    rt_ns_t worst_cross_ns;
+} clock_result_t;
+
+static unsigned long reads = DEFAULT_READS, rounds = DEFAULT_ROUNDS;
+
+// Cross-core hand-over, the two sides spin on their own turn
+static const clock_def_t *cross_clock;
+static _Alignas(64) atomic_llong cross_stamp;
+static _Alignas(64) atomic_int cross_turn;
+static unsigned long long cross_violations[2];
+static rt_ns_t cross_worst[2];
+
+static inline rt_ns_t read_clock(const clock_def_t *c) {
+    return c->cycles ? rt_cycles_now() : rt_time_now(c->id);
+}
+
+static void pin(int cpu) {
+    cpu_set_t cpuset;
+
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu % get_nprocs(), &cpuset);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+}
+
+static double read_cost(const clock_def_t *c) {
+    volatile rt_ns_t sink;
+    rt_ns_t start, elapsed, best = RT_TIME_MAX;
+    unsigned long i, batch = reads / CLOCK_BATCHES + 1;
+    int b;
+
+    for (i = 0; i < 1000; i++)
+        sink = read_clock(c);
+    for (b = 0; b < CLOCK_BATCHES; b++) {
+        start = rt_time_mono();
+        for (i = 0; i < batch; i++)
+            sink = read_clock(c);
+        elapsed = rt_time_mono() - start;
+        if (elapsed < best)
+            best = elapsed;
+    }
+    (void)sink;
+    return (double)best / batch;
+}
+
+// Back-to-back reads on one core, for at least CLOCK_STEP_MIN_MS so a
+// coarse clock ticks a few times
+static void steps(const clock_def_t *c, clock_result_t *res, unsigned long n) {
+    rt_ns_t prev, now, d, end = rt_time_mono() + CLOCK_STEP_MIN_MS * RT_NSEC_PER_MSEC;
+    unsigned long i = 0, j, repeats = 0;
+
+    prev = read_clock(c);
+    do {
+        for (j = 0; j < 1024; j++) {
+            now = read_clock(c);
+            d = now - prev;
+            if (d < 0) {
+                res->backwards++;
+                if (-d > res->worst_backwards_ns)
+                    res->worst_backwards_ns = -d;
+            } else if (d == 0) {
+                repeats++;
+            } else if (d < res->step_ns) {
+                res->step_ns = d;
+            }
+            prev = now;
+        }
+        i += j;
+    } while (i < n || rt_time_mono() < end);
+    res->repeat_pct += 100.0 * repeats / i;
+}
+
+typedef struct
+{
+    int side;                           // 0 goes first
+    int cpu;
+} cross_arg_t;
+
+// Each side waits for its turn, reads its clock and checks it against the
+// time the other side published just before handing over
+static void *cross_side(void *arg) {
+    const cross_arg_t *a = arg;
+    rt_ns_t now, d;
+    unsigned long r;
+
+    pin(a->cpu);
+    for (r = 0; r < rounds; r++) {
+        while (atomic_load_explicit(&cross_turn, memory_order_acquire) != a->side)
+            ;
+        now = read_clock(cross_clock);
+        d = atomic_load_explicit(&cross_stamp, memory_order_relaxed) - now;
+        if (d > 0) {
+            cross_violations[a->side]++;
+            if (d > cross_worst[a->side])
+                cross_worst[a->side] = d;
+        }
+        atomic_store_explicit(&cross_stamp, now, memory_order_relaxed);
+        atomic_store_explicit(&cross_turn, !a->side, memory_order_release);
+    }
+    return NULL;
+}
+
+// First core against every other one
+static void cross_core(const clock_def_t *c, clock_result_t *res, int ncpu) {
+    pthread_t threads[2];
+    cross_arg_t args[2];
+    int cpu, side;
+
+    cross_clock = c;
+    for (cpu = 1; cpu < ncpu; cpu++) {
+        memset(cross_violations, 0, sizeof(cross_violations));
+        memset(cross_worst, 0, sizeof(cross_worst));
+        atomic_store(&cross_stamp, 0);
+        atomic_store(&cross_turn, 0);
+        for (side = 0; side < 2; side++) {
+            args[side].side = side;
+            args[side].cpu = side ? cpu : 0;
+            pthread_create(&threads[side], NULL, cross_side, &args[side]);
+        }
+        for (side = 0; side < 2; side++) {
+            pthread_join(threads[side], NULL);
+            res->cross_violations += cross_violations[side];
+            if (cross_worst[side] > res->worst_cross_ns)
+                res->worst_cross_ns = cross_worst[side];
+        }
+        res->cross_rounds += 2 * rounds;
+    }
+}
+
+static void measure(const clock_def_t *c, clock_result_t *res, int ncpu) {
+    struct timespec ts;
+    int cpu;
+
+    memset(res, 0, sizeof(*res));
+    res->step_ns = RT_TIME_MAX;
+    // A counter tick is under a nanosecond on most machines, shown as 1
+    if (c->cycles)
+        res->res_ns = (rt_cycles_to_ns(1) > 0) ? rt_cycles_to_ns(1) : 1;
+    else if (clock_getres(c->id, &ts) == 0)
+        res->res_ns = rt_time_from_ts(&ts);
+
+    pin(0);
+    res->read_ns = read_cost(c);
+
+    // Monotonicity on every core in turn, the same number of reads in all
+    for (cpu = 0; cpu < ncpu; cpu++) {
+        pin(cpu);
+        steps(c, res, reads / ncpu + 1);
+    }
+    res->repeat_pct /= ncpu;
+    if (res->step_ns == RT_TIME_MAX)
+        res->step_ns = 0;
+
+    if (c->cross)
+        cross_core(c, res, ncpu);
+}
+
+int main(int argc, char *argv[])
+{
+    clock_result_t res;
+    const char *csv_path = NULL;
+    FILE *csv = NULL;
+    struct timespec ts;
+    int opt, i, ncpu = get_nprocs();
+
+    while ((opt = getopt(argc, argv, "n:r:c:")) != -1) {
+        switch (opt) {
+        case 'n':
+            reads = strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            rounds = strtoul(optarg, NULL, 10);
+            break;
+        case 'c':
+            csv_path = optarg;
+            break;
+        default:
+            printf("Usage: %s [-n reads] [-r rounds] [-c out.csv]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    if (csv_path != NULL) {
+        csv = fopen(csv_path, "w");
+        if (csv == NULL) {
+            perror(csv_path);
+            return -1;
+        }
+        fprintf(csv, "clock,resolution_ns,read_ns,step_ns,repeat_pct,backwards,worst_backwards_ns,"
+                     "cross_rounds,cross_violations,worst_cross_ns\n");
+    }
+
+    rt_cycles_init();
+    rt_cycles_report();
+    printf("%d cores, %lu reads per clock, %lu cross-core rounds per core pair%s\n\n", ncpu, reads, rounds,
+           (ncpu < 2) ? " (one core, not compared)" : "");
+    printf("%-17s %10s %8s %10s %8s %10s %10s %12s %10s\n", "clock", "res ns", "read ns", "step ns", "repeat%",
+           "backwards", "worst ns", "cross viol", "worst ns");
+
+    for (i = 0; i < NUM_CLOCKS; i++) {
+        if (clocks[i].cycles && rt_cycles_cal.source == RT_CYCLES_CLOCK)
+            continue;
+        if (!clocks[i].cycles && clock_gettime(clocks[i].id, &ts) != 0) {
+            printf("%-17s not available\n", clocks[i].name);
+            continue;
+        }
+
+        measure(&clocks[i], &res, ncpu);
+
+        printf("%-17s %10lld %8.1f %10lld %8.1f %10llu %10lld", clocks[i].name, (long long)res.res_ns, res.read_ns,
+               (long long)res.step_ns, res.repeat_pct, res.backwards, (long long)res.worst_backwards_ns);
+        if (res.cross_rounds > 0)
+            printf(" %12llu %10lld\n", res.cross_violations, (long long)res.worst_cross_ns);
+        else
+            printf(" %12s %10s\n", "-", "-");
+        if (csv != NULL)
+            fprintf(csv, "%s,%lld,%.2f,%lld,%.2f,%llu,%lld,%llu,%llu,%lld\n", clocks[i].name,
+                    (long long)res.res_ns, res.read_ns, (long long)res.step_ns, res.repeat_pct, res.backwards,
+                    (long long)res.worst_backwards_ns, res.cross_rounds, res.cross_violations,
+                    (long long)res.worst_cross_ns);
+    }
+
+    if (csv != NULL)
+        fclose(csv);
+    return 0;
+}
@@ -0,0 +1,767 @@
+/**
+ * File: clog.c
+ * Author: Brad Waggle
+ * Description: Compact binary form of the run log, and its reader.
+ * Date: October 18, 2026
+ */
+
+// The text run log spends most of each line on what barely changes: a 32
+// character time stamp, the host and ident, "[COURSE:2][ASSIGNMENT:6]: "
+// and the fixed words of the message. Here every message is a varint
+// record. Times are microsecond deltas from the message before (the text
+// log's resolution), the course and assignment pair is a small id, and
+// formats, messages and %s arguments are interned strings, defined in
+// every block that uses them and referred to by id. A log_sysf() message
+// keeps its format id and arguments as the writer thread got them, never
+// formatted: integers are stored as the difference from the same argument
+// of the format's previous message and doubles as the XOR with it, so
+// counters, cores and time stamps take a byte or a few.
+//
+// Records go into CLOG_BLOCK_BYTES blocks, each with its first and last
+// time and decodable on its own: deltas start over at every block and a
+// string or source is defined again before its first use in each block,
+// which costs a few hundred bytes per 64 KB block for the formats a run
+// keeps using. At close a footer repeats every definition and lists the
+// blocks, so a reader can start at the block that holds a given time.
+// Without a footer (the process died) the index is rebuilt by walking the
+// block headers, nothing before the block wanted is decoded either way.
+//
+// Record head varint (x << 2) | type:
+//   0 definition, x = 0 string: id, length, bytes
+//                 x = 1 source: id, zigzag course, zigzag assignment
+//   1 text message, x = source: zigzag time delta, string id
+//   2 formatted message, x = source: zigzag time delta, format string id,
+//     then per conversion a zigzag integer delta, a double XOR or a string id
+//   3 inline text, x = source: zigzag time delta, length, bytes
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "clog.h"
+
+#define CLOG_REC_DEF (0)
+#define CLOG_REC_TEXT (1)
+#define CLOG_REC_FMT (2)
+#define CLOG_REC_INLINE (3)
+
+#define CLOG_DEF_STRING (0)
+#define CLOG_DEF_SOURCE (1)
+
+// How an argument is stored, by its conversion
+#define CLOG_ARG_INT (0)
+#define CLOG_ARG_DOUBLE (1)
+#define CLOG_ARG_STRING (2)
+
+// Room one message can take with its definitions: its source, the message
+// or format and every %s argument defined in the block
+#define CLOG_EVENT_MAX ((LOG_FMT_MAX_ARGS + 1) * (CLOG_TEXT_MAX + 16) + 128)
+
+#define CLOG_HASH_SLOTS (CLOG_MAX_STRINGS * 2)
+
+// Writer state
+static int clog_fd = -1;
+static char clog_path[100];
+static unsigned char block_buf[CLOG_BLOCK_BYTES];
+static size_t block_used;
+static clog_block_header_t block_hdr;
+static uint32_t block_no;           // blocks begun, the current one's number from 1
+static uint64_t prev_us;
+static uint64_t file_offset;
+static clog_index_t *index_list;
+static uint32_t nblocks, index_cap;
+
+static clog_string_t *strings;
+static uint32_t nstrings;
+static char *arena;
+static size_t arena_used;
+static uint32_t *slots;             // string id + 1 by hash
+static uint32_t *fmt_ids;           // string id + 1 by log_fmt id
+static int nfmt_ids;
+static int sources[CLOG_MAX_SOURCES][2];
+static int nsources;
+static uint32_t source_defined[CLOG_MAX_SOURCES];  // last block each was defined in
+
+static unsigned long long events, inlined, lost, write_errors;
+
+static inline unsigned char *put_varint(unsigned char *p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (unsigned char)v;
+    return p;
+}
+
+static inline const unsigned char *get_varint(const unsigned char *p, const unsigned char *end, uint64_t *v) {
+    uint64_t x = 0;
+    int shift;
+
+    for (shift = 0; p < end && shift < 64; shift += 7) {
+        x |= (uint64_t)(*p & 0x7f) << shift;
+        if ((*p++ & 0x80) == 0) {
+            *v = x;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static inline uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// Storage class of each conversion, walked as format_args() in sys_logger.c walks it
+static int arg_classes(const char *fmt, unsigned char *classes) {
+    const char *conv;
+    int n = 0;
+
+    while (*fmt != '\0' && n < LOG_FMT_MAX_ARGS) {
+        if (*fmt != '%' || fmt[1] == '%') {
+            fmt += (*fmt == '%') ? 2 : 1;
+            continue;
+        }
+        conv = fmt + 1 + strspn(fmt + 1, "-+ #0123456789.hlLqjzt");
+        if (*conv == '\0')
+            break;
+        fmt = conv + 1;
+
+        if (strchr("fFeEgGaA", *conv) != NULL)
+            classes[n++] = CLOG_ARG_DOUBLE;
+        else if (*conv == 's')
+            classes[n++] = CLOG_ARG_STRING;
+        else if (strchr("diuoxXcp", *conv) != NULL)
+            classes[n++] = CLOG_ARG_INT;
+    }
+    return n;
+}
+
+static uint32_t hash_text(const char *text, size_t len) {
+    uint32_t h = 2166136261U;
+
+    while (len-- > 0)
+        h = (h ^ (unsigned char)*text++) * 16777619U;
+    return h;
+}
+
+// Write the current block and note it in the index
+static void flush_block(void) {
+    struct iovec iov[2];
+    clog_index_t *grown;
+    ssize_t want;
+
+    if (block_used == 0)
+        return;
+
+    block_hdr.magic = CLOG_BLOCK_MAGIC;
+    block_hdr.bytes = block_used;
+    iov[0].iov_base = &block_hdr;
+    iov[0].iov_len = sizeof(block_hdr);
+    iov[1].iov_base = block_buf;
+    iov[1].iov_len = block_used;
+    want = sizeof(block_hdr) + block_used;
+    if (writev(clog_fd, iov, 2) != want) {
+        perror("clog write");
+        write_errors++;
+        block_used = 0;
+        return;
+    }
+
+    if (nblocks == index_cap) {
+        index_cap = index_cap ? index_cap * 2 : 256;
+        grown = realloc(index_list, index_cap * sizeof(clog_index_t));
+        if (grown == NULL) {
+            perror("clog index");
+            index_cap = nblocks;
+        } else {
+            index_list = grown;
+        }
+    }
+    if (nblocks < index_cap) {
+        index_list[nblocks].offset = file_offset;
+        index_list[nblocks].first_ns = block_hdr.first_ns;
+        index_list[nblocks].last_ns = block_hdr.last_ns;
+        index_list[nblocks].events = block_hdr.events;
+        index_list[nblocks].reserved = 0;
+        nblocks++;
+    }
+
+    file_offset += want;
+    block_used = 0;
+}
+
+// Make room for one message, starting a block if needed
+static void begin_event(uint64_t ns) {
+    if (block_used + CLOG_EVENT_MAX > CLOG_BLOCK_BYTES)
+        flush_block();
+
+    if (block_used == 0) {
+        block_no++;
+        memset(&block_hdr, 0, sizeof(block_hdr));
+        block_hdr.first_ns = ns;
+        block_hdr.last_ns = ns;
+        prev_us = ns / 1000;
+    }
+}
+
+static void end_event(unsigned char *p, uint64_t ns) {
+    block_used = p - block_buf;
+    block_hdr.events++;
+    if (ns > block_hdr.last_ns)
+        block_hdr.last_ns = ns;
+    events++;
+}
+
+static unsigned char *put_string_def(unsigned char *p, uint32_t id) {
+    p = put_varint(p, (CLOG_DEF_STRING << 2) | CLOG_REC_DEF);
+    p = put_varint(p, id);
+    p = put_varint(p, strings[id].len);
+    memcpy(p, strings[id].text, strings[id].len);
+    return p + strings[id].len;
+}
+
+static unsigned char *put_source_def(unsigned char *p, int id) {
+    p = put_varint(p, (CLOG_DEF_SOURCE << 2) | CLOG_REC_DEF);
+    p = put_varint(p, id);
+    p = put_varint(p, zigzag(sources[id][0]));
+    return put_varint(p, zigzag(sources[id][1]));
+}
+
+// Define a string in the current block unless it already is
+static void use_string(uint32_t id) {
+    if (strings[id].defined != block_no) {
+        block_used = put_string_def(block_buf + block_used, id) - block_buf;
+        strings[id].defined = block_no;
+    }
+}
+
+// Id of a string, defined in the current block, -1 when the table is full
+static int intern(const char *text, size_t len) {
+    uint32_t slot = hash_text(text, len) & (CLOG_HASH_SLOTS - 1);
+    clog_string_t *s;
+
+    while (slots[slot] != 0) {
+        s = &strings[slots[slot] - 1];
+        if (s->len == len && memcmp(s->text, text, len) == 0) {
+            use_string(slots[slot] - 1);
+            return slots[slot] - 1;
+        }
+        slot = (slot + 1) & (CLOG_HASH_SLOTS - 1);
+    }
+
+    if (nstrings == CLOG_MAX_STRINGS || arena_used + len + 1 > CLOG_STRING_BYTES)
+        return -1;
+
+    s = &strings[nstrings];
+    memcpy(arena + arena_used, text, len);
+    arena[arena_used + len] = '\0';
+    s->text = arena + arena_used;
+    s->len = len;
+    s->fmt.nargs = -1;
+    arena_used += len + 1;
+    s->defined = 0;
+    slots[slot] = ++nstrings;
+
+    use_string(nstrings - 1);
+    return nstrings - 1;
+}
+
+static int source_id(int course, int assignment) {
+    int i;
+
+    for (i = 0; i < nsources; i++)
+        if (sources[i][0] == course && sources[i][1] == assignment)
+            break;
+    if (i == CLOG_MAX_SOURCES)
+        return -1;
+    if (i == nsources) {
+        sources[i][0] = course;
+        sources[i][1] = assignment;
+        source_defined[i] = 0;
+        nsources++;
+    }
+
+    // Defined in every block that names it
+    if (source_defined[i] != block_no) {
+        block_used = put_source_def(block_buf + block_used, i) - block_buf;
+        source_defined[i] = block_no;
+    }
+    return i;
+}
+
+static inline uint64_t ts_to_ns(const struct timespec *ts) {
+    return (uint64_t)ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+}
+
+// Create the file, nfmts is how many log_sysf() call sites ids can name
+int clog_open(const char *path, const char *host, const char *ident, int nfmts) {
+    clog_file_header_t header;
+    struct timespec now;
+
+    strings = calloc(CLOG_MAX_STRINGS, sizeof(clog_string_t));
+    arena = malloc(CLOG_STRING_BYTES);
+    slots = calloc(CLOG_HASH_SLOTS, sizeof(uint32_t));
+    nfmt_ids = nfmts + 1;
+    fmt_ids = calloc(nfmt_ids, sizeof(uint32_t));
+    if (strings == NULL || arena == NULL || slots == NULL || fmt_ids == NULL) {
+        printf("Failed to reserve the clog string table\n");
+        clog_close();
+        return -1;
+    }
+
+    snprintf(clog_path, sizeof(clog_path), "%s", path);
+    clog_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (clog_fd < 0) {
+        perror("clog open");
+        clog_close();
+        return -1;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CLOG_MAGIC, sizeof(header.magic));
+    header.version = CLOG_VERSION;
+    header.pid = getpid();
+    clock_gettime(CLOCK_REALTIME, &now);
+    header.start_ns = ts_to_ns(&now);
+    snprintf(header.host, sizeof(header.host), "%s", host);
+    snprintf(header.ident, sizeof(header.ident), "%s", ident);
+    if (write(clog_fd, &header, sizeof(header)) != sizeof(header)) {
+        perror("clog header");
+        clog_close();
+        return -1;
+    }
+
+    file_offset = sizeof(header);
+    block_used = 0;
+    block_no = 0;
+    nblocks = 0;
+    nstrings = 0;
+    arena_used = 0;
+    nsources = 0;
+    events = inlined = lost = write_errors = 0;
+    return 0;
+}
+
+// One fixed text message, interned or inline once the table is full
+void clog_text(const struct timespec *ts, int course, int assignment, const char *text) {
+    uint64_t ns = ts_to_ns(ts);
+    size_t len = strnlen(text, CLOG_TEXT_MAX - 1);
+    unsigned char *p;
+    int src, id;
+
+    if (clog_fd < 0)
+        return;
+
+    // One line per message, as the text run log drops the newline callers often end with
+    while (len > 0 && text[len - 1] == '\n')
+        len--;
+
+    begin_event(ns);
+    src = source_id(course, assignment);
+    if (src < 0) {
+        lost++;
+        return;
+    }
+    id = intern(text, len);
+
+    p = block_buf + block_used;
+    p = put_varint(p, ((uint64_t)src << 2) | ((id >= 0) ? CLOG_REC_TEXT : CLOG_REC_INLINE));
+    p = put_varint(p, zigzag((int64_t)(ns / 1000 - prev_us)));
+    prev_us = ns / 1000;
+    if (id >= 0) {
+        p = put_varint(p, id);
+    } else {
+        p = put_varint(p, len);
+        memcpy(p, text, len);
+        p += len;
+        inlined++;
+    }
+    end_event(p, ns);
+}
+
+// One log_sysf() message, its arguments stored as captured
+void clog_fmt(const struct timespec *ts, int course, int assignment, unsigned int fmt_id,
+              const log_fmt_t *fmt, const log_arg_t *args) {
+    uint64_t ns = ts_to_ns(ts);
+    int src, id, sid[LOG_FMT_MAX_ARGS] = { 0 }, a;
+    char text[CLOG_TEXT_MAX];
+    unsigned char *p;
+    clog_string_t *s;
+    log_arg_t arg;
+
+    if (clog_fd < 0)
+        return;
+
+    begin_event(ns);
+    src = source_id(course, assignment);
+    if (src < 0) {
+        lost++;
+        return;
+    }
+
+    if (fmt_id < (unsigned int)nfmt_ids && fmt_ids[fmt_id] != 0) {
+        id = fmt_ids[fmt_id] - 1;
+        use_string(id);
+    } else {
+        id = intern(fmt->fmt, strnlen(fmt->fmt, CLOG_TEXT_MAX - 1));
+        if (id >= 0 && fmt_id < (unsigned int)nfmt_ids)
+            fmt_ids[fmt_id] = id + 1;
+    }
+
+    s = (id >= 0) ? &strings[id] : NULL;
+    if (s != NULL && s->fmt.nargs < 0) {
+        s->fmt.fmt = s->text;
+        s->fmt.nargs = arg_classes(s->text, s->classes);
+    }
+
+    // %s arguments are defined before the record that names them
+    for (a = 0; s != NULL && a < s->fmt.nargs; a++)
+        if (s->classes[a] == CLOG_ARG_STRING) {
+            arg = (a < fmt->nargs) ? args[a] : 0;
+            sid[a] = (arg != 0) ? intern((const char *)(uintptr_t)arg,
+                                         strnlen((const char *)(uintptr_t)arg, CLOG_TEXT_MAX - 1)) : -1;
+            if (sid[a] < 0)
+                s = NULL;
+        }
+
+    // Out of table space, keep the message as text
+    if (s == NULL) {
+        log_format_args(text, sizeof(text), fmt, args);
+        clog_text(ts, course, assignment, text);
+        return;
+    }
+
+    if (s->block != block_no) {
+        memset(s->prev, 0, sizeof(s->prev));
+        s->block = block_no;
+    }
+
+    p = block_buf + block_used;
+    p = put_varint(p, ((uint64_t)src << 2) | CLOG_REC_FMT);
+    p = put_varint(p, zigzag((int64_t)(ns / 1000 - prev_us)));
+    prev_us = ns / 1000;
+    p = put_varint(p, id);
+    for (a = 0; a < s->fmt.nargs; a++) {
+        arg = (a < fmt->nargs) ? args[a] : 0;
+        switch (s->classes[a]) {
+        case CLOG_ARG_DOUBLE:
+            p = put_varint(p, arg ^ s->prev[a]);
+            break;
+        case CLOG_ARG_STRING:
+            p = put_varint(p, sid[a]);
+            break;
+        default:
+            p = put_varint(p, zigzag((int64_t)(arg - s->prev[a])));
+            break;
+        }
+        s->prev[a] = arg;
+    }
+    end_event(p, ns);
+}
+
+// Write the last block and the footer
+void clog_close(void) {
+    clog_trailer_t trailer;
+    unsigned char *defs, *p;
+    uint32_t i;
+    int j;
+
+    if (clog_fd >= 0) {
+        flush_block();
+
+        defs = malloc(arena_used + (nstrings + nsources) * 32 + 1);
+        if (defs != NULL) {
+            p = defs;
+            for (j = 0; j < nsources; j++)
+                p = put_source_def(p, j);
+            for (i = 0; i < nstrings; i++)
+                p = put_string_def(p, i);
+
+            trailer.defs_offset = file_offset;
+            trailer.defs_bytes = p - defs;
+            trailer.index_offset = file_offset + trailer.defs_bytes;
+            trailer.blocks = nblocks;
+            trailer.magic = CLOG_TRAILER_MAGIC;
+            if (write(clog_fd, defs, p - defs) != p - defs ||
+                write(clog_fd, index_list, nblocks * sizeof(clog_index_t)) != (ssize_t)(nblocks * sizeof(clog_index_t)) ||
+                write(clog_fd, &trailer, sizeof(trailer)) != sizeof(trailer)) {
+                perror("clog footer");
+                write_errors++;
+            }
+            file_offset = trailer.index_offset + nblocks * sizeof(clog_index_t) + sizeof(trailer);
+            free(defs);
+        }
+
+        close(clog_fd);
+        clog_fd = -1;
+    }
+
+    free(strings);
+    free(arena);
+    free(slots);
+    free(fmt_ids);
+    free(index_list);
+    strings = NULL;
+    arena = NULL;
+    slots = NULL;
+    fmt_ids = NULL;
+    index_list = NULL;
+    index_cap = 0;
+}
+
+void clog_report(void) {
+    printf("Run log written to %s, %llu bytes, %llu messages in %u blocks (%.1f bytes each)\n", clog_path,
+           (unsigned long long)file_offset, events, nblocks, events ? (double)file_offset / events : 0.0);
+    printf("clog: %u strings interned, %llu messages inline, %llu lost, %llu write errors\n",
+           nstrings, inlined, lost, write_errors);
+}
+
+// Read the header, and the footer if the file has one
+int clog_reader_open(clog_reader_t *r, const char *path) {
+    const clog_trailer_t *trailer;
+    clog_block_header_t hdr;
+    struct stat st;
+    uint64_t off;
+    int fd;
+
+    memset(r, 0, sizeof(*r));
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(path);
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    r->size = st.st_size;
+    r->map = (r->size > 0) ? mmap(NULL, r->size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (r->map == MAP_FAILED) {
+        perror("clog mmap");
+        r->map = NULL;
+        return -1;
+    }
+
+    r->header = (const clog_file_header_t *)r->map;
+    if (r->size < sizeof(clog_file_header_t) || memcmp(r->header->magic, CLOG_MAGIC, 8) != 0 ||
+        r->header->version != CLOG_VERSION) {
+        printf("%s is not a clog file, or from another version\n", path);
+        clog_reader_close(r);
+        return -1;
+    }
+    madvise((void *)r->map, r->size, MADV_SEQUENTIAL);
+
+    r->strings = calloc(CLOG_MAX_STRINGS, sizeof(clog_string_t));
+    if (r->strings == NULL) {
+        clog_reader_close(r);
+        return -1;
+    }
+
+    // The footer has every definition and the index
+    trailer = (const clog_trailer_t *)(r->map + r->size - sizeof(clog_trailer_t));
+    if (r->size >= sizeof(clog_file_header_t) + sizeof(clog_trailer_t) && trailer->magic == CLOG_TRAILER_MAGIC &&
+        trailer->defs_offset + trailer->defs_bytes == trailer->index_offset &&
+        trailer->index_offset + trailer->blocks * sizeof(clog_index_t) + sizeof(clog_trailer_t) == r->size) {
+        r->blocks = trailer->blocks;
+        r->index = malloc((r->blocks + 1) * sizeof(clog_index_t));
+        if (r->index == NULL) {
+            clog_reader_close(r);
+            return -1;
+        }
+        memcpy(r->index, r->map + trailer->index_offset, r->blocks * sizeof(clog_index_t));
+
+        r->pos = r->map + trailer->defs_offset;
+        r->end = r->pos + trailer->defs_bytes;
+        while (r->pos < r->end)
+            if (clog_reader_next(r, NULL) < 0) {
+                printf("%s: bad definitions in the footer\n", path);
+                clog_reader_close(r);
+                return -1;
+            }
+        r->defs_complete = 1;
+        r->pos = r->end = NULL;
+        return 0;
+    }
+
+    // No footer, find the complete blocks from the start
+    for (off = sizeof(clog_file_header_t); off + sizeof(hdr) <= r->size; off += sizeof(hdr) + hdr.bytes) {
+        memcpy(&hdr, r->map + off, sizeof(hdr));
+        if (hdr.magic != CLOG_BLOCK_MAGIC || off + sizeof(hdr) + hdr.bytes > r->size)
+            break;
+        if ((r->blocks & (r->blocks - 1)) == 0) {
+            clog_index_t *grown = realloc(r->index, (r->blocks ? r->blocks * 2 : 1) * sizeof(clog_index_t));
+
+            if (grown == NULL) {
+                clog_reader_close(r);
+                return -1;
+            }
+            r->index = grown;
+        }
+        r->index[r->blocks].offset = off;
+        r->index[r->blocks].first_ns = hdr.first_ns;
+        r->index[r->blocks].last_ns = hdr.last_ns;
+        r->index[r->blocks].events = hdr.events;
+        r->blocks++;
+    }
+    return 0;
+}
+
+// Go to the first block that holds messages at or after ts_ns. Earlier
+// messages of that block still come first, the caller skips them.
+int clog_reader_seek(clog_reader_t *r, uint64_t ts_ns) {
+    uint32_t lo = 0, hi = r->blocks, mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (r->index[mid].last_ns < ts_ns)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    // Argument deltas start over in every block visited, and the block
+    // defines every string it uses, so nothing before it is decoded
+    for (mid = 0; mid < CLOG_MAX_STRINGS; mid++)
+        r->strings[mid].block = 0;
+
+    r->block = lo;
+    r->pos = r->end = NULL;
+    return 0;
+}
+
+// Decode the next message, 1 when there is one, 0 at the end and -1 on a
+// damaged file. With ev NULL only a definition is read, for the footer.
+int clog_reader_next(clog_reader_t *r, clog_event_t *ev) {
+    clog_block_header_t hdr;
+    const unsigned char *p = r->pos, *end = r->end;
+    clog_string_t *s;
+    uint64_t head, v, id, len, c, a;
+    int i;
+
+    for (;;) {
+        if (p == end) {
+            if (ev == NULL || r->block >= r->blocks)
+                return 0;
+            memcpy(&hdr, r->map + r->index[r->block].offset, sizeof(hdr));
+            p = r->map + r->index[r->block].offset + sizeof(hdr);
+            end = p + hdr.bytes;
+            r->prev_us = hdr.first_ns / 1000;
+            r->block++;
+            continue;
+        }
+
+        if ((p = get_varint(p, end, &head)) == NULL)
+            return -1;
+
+        if ((head & 3) == CLOG_REC_DEF) {
+            if ((p = get_varint(p, end, &id)) == NULL)
+                return -1;
+            if ((head >> 2) == CLOG_DEF_SOURCE) {
+                if ((p = get_varint(p, end, &c)) == NULL || (p = get_varint(p, end, &a)) == NULL ||
+                    id >= CLOG_MAX_SOURCES)
+                    return -1;
+                r->sources[id][0] = unzigzag(c);
+                r->sources[id][1] = unzigzag(a);
+            } else {
+                if ((p = get_varint(p, end, &len)) == NULL || len > (uint64_t)(end - p) || id >= CLOG_MAX_STRINGS)
+                    return -1;
+                s = &r->strings[id];
+                if (s->text == NULL) {
+                    s->text = strndup((const char *)p, len);
+                    s->len = len;
+                }
+                p += len;
+            }
+            if (ev == NULL) {
+                r->pos = p;
+                r->end = end;
+                return 1;
+            }
+            continue;
+        }
+
+        // A message
+        if (ev == NULL || (head >> 2) >= CLOG_MAX_SOURCES || (p = get_varint(p, end, &v)) == NULL)
+            return -1;
+        r->prev_us += unzigzag(v);
+        ev->ts_ns = r->prev_us * 1000;
+        ev->course = r->sources[head >> 2][0];
+        ev->assignment = r->sources[head >> 2][1];
+        ev->text = NULL;
+        ev->fmt = NULL;
+
+        switch (head & 3) {
+        case CLOG_REC_TEXT:
+            if ((p = get_varint(p, end, &id)) == NULL || id >= CLOG_MAX_STRINGS || r->strings[id].text == NULL)
+                return -1;
+            ev->text = r->strings[id].text;
+            break;
+        case CLOG_REC_INLINE:
+            if ((p = get_varint(p, end, &len)) == NULL || len > (uint64_t)(end - p) || len >= CLOG_TEXT_MAX)
+                return -1;
+            memcpy(r->inline_text, p, len);
+            r->inline_text[len] = '\0';
+            ev->text = r->inline_text;
+            p += len;
+            break;
+        default:
+            if ((p = get_varint(p, end, &id)) == NULL || id >= CLOG_MAX_STRINGS || r->strings[id].text == NULL)
+                return -1;
+            s = &r->strings[id];
+            if (s->fmt.fmt == NULL) {
+                s->fmt.fmt = s->text;
+                s->fmt.nargs = arg_classes(s->text, s->classes);
+            }
+            if (s->block != r->block) {
+                memset(s->prev, 0, sizeof(s->prev));
+                s->block = r->block;
+            }
+            for (i = 0; i < s->fmt.nargs; i++) {
+                if ((p = get_varint(p, end, &v)) == NULL)
+                    return -1;
+                switch (s->classes[i]) {
+                case CLOG_ARG_DOUBLE:
+                    s->prev[i] ^= v;
+                    break;
+                case CLOG_ARG_STRING:
+                    if (v >= CLOG_MAX_STRINGS || r->strings[v].text == NULL)
+                        return -1;
+                    s->prev[i] = (uintptr_t)r->strings[v].text;
+                    break;
+                default:
+                    s->prev[i] += unzigzag(v);
+                    break;
+                }
+                ev->args[i] = s->prev[i];
+            }
+            ev->fmt = &s->fmt;
+            break;
+        }
+
+        r->pos = p;
+        r->end = end;
+        return 1;
+    }
+}
+
+void clog_reader_close(clog_reader_t *r) {
+    int i;
+
+    if (r->strings != NULL)
+        for (i = 0; i < CLOG_MAX_STRINGS; i++)
+            free((void *)r->strings[i].text);
+    free(r->strings);
+    free(r->index);
+    if (r->map != NULL)
+        munmap((void *)r->map, r->size);
+    memset(r, 0, sizeof(*r));
+}
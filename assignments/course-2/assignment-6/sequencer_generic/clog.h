@@ -0,0 +1,121 @@
+#ifndef CLOG_H
+#define CLOG_H
+
+#include <stdint.h>
+#include <time.h>
+#include "sys_logger.h"
+
+#define CLOG_MAGIC "SEQCLOG1"
+#define CLOG_VERSION (2)
+#define CLOG_BLOCK_MAGIC (0x42474c43U)      // "CLGB"
+#define CLOG_TRAILER_MAGIC (0x54474c43U)    // "CLGT"
+
+// Bytes of events per block, a block is decoded on its own
+#define CLOG_BLOCK_BYTES (64 * 1024)
+
+// Interned strings (formats, messages, %s arguments) and their bytes,
+// messages past either limit are written inline instead
+#define CLOG_MAX_STRINGS (4096)
+#define CLOG_STRING_BYTES (256 * 1024)
+
+// [COURSE][ASSIGNMENT] pairs
+#define CLOG_MAX_SOURCES (64)
+
+// Longest message or %s argument kept, as log_sys() truncates its messages
+#define CLOG_TEXT_MAX (256)
+
+// File layout: header, blocks, then a footer of every definition, the
+// block index and the trailer. A file without a footer (the writer did
+// not get to close it) is still read, its blocks found by their headers.
+typedef struct
+{
+    char magic[8];                  // CLOG_MAGIC
+    uint32_t version;
+    uint32_t pid;                   // process that logged, for the text form
+    uint64_t start_ns;              // CLOCK_REALTIME when the file was opened
+    char host[64];
+    char ident[16];
+} clog_file_header_t;
+
+typedef struct
+{
+    uint32_t magic;                 // CLOG_BLOCK_MAGIC
+    uint32_t bytes;                 // encoded events that follow
+    uint32_t events;
+    uint32_t reserved;
+    uint64_t first_ns;              // time of the first message, the base of the deltas
+    uint64_t last_ns;               // latest event time in the block
+} clog_block_header_t;
+
+typedef struct
+{
+    uint64_t offset;                // of the block header
+    uint64_t first_ns;
+    uint64_t last_ns;
+    uint32_t events;
+    uint32_t reserved;
+} clog_index_t;
+
+typedef struct
+{
+    uint64_t defs_offset;           // definitions, encoded as in a block
+    uint64_t defs_bytes;
+    uint64_t index_offset;          // one clog_index_t per block
+    uint32_t blocks;
+    uint32_t magic;                 // CLOG_TRAILER_MAGIC, last in the file
+} clog_trailer_t;
+
+// Writer, one thread at a time: the caller of log_sys() until
+// log_sys_start(), then the log_sys writer thread
+int clog_open(const char *path, const char *host, const char *ident, int nfmts);
+void clog_text(const struct timespec *ts, int course, int assignment, const char *text);
+void clog_fmt(const struct timespec *ts, int course, int assignment, unsigned int fmt_id,
+              const log_fmt_t *fmt, const log_arg_t *args);
+void clog_close(void);
+void clog_report(void);
+
+// One decoded message, text or a format with its arguments
+typedef struct
+{
+    uint64_t ts_ns;                 // CLOCK_REALTIME, to the microsecond
+    int course;
+    int assignment;
+    const char *text;               // NULL for a formatted message
+    const log_fmt_t *fmt;
+    log_arg_t args[LOG_FMT_MAX_ARGS];
+} clog_event_t;
+
+typedef struct
+{
+    const char *text;
+    uint32_t len;
+    log_fmt_t fmt;                  // filled in when first used as a format
+    unsigned char classes[LOG_FMT_MAX_ARGS];
+    uint64_t prev[LOG_FMT_MAX_ARGS];
+    uint32_t block;                 // block prev[] belongs to
+    uint32_t defined;               // writer: last block the string was defined in
+} clog_string_t;
+
+// Reader over a mapped file
+typedef struct
+{
+    const unsigned char *map;
+    size_t size;
+    const clog_file_header_t *header;
+    clog_index_t *index;
+    uint32_t blocks;
+    uint32_t block;                 // blocks begun, the one being decoded is number block
+    const unsigned char *pos, *end;
+    uint64_t prev_us;
+    clog_string_t *strings;
+    int sources[CLOG_MAX_SOURCES][2];
+    char inline_text[CLOG_TEXT_MAX];
+    int defs_complete;              // the footer defined every string up front
+} clog_reader_t;
+
+int clog_reader_open(clog_reader_t *r, const char *path);
+int clog_reader_seek(clog_reader_t *r, uint64_t ts_ns);
+int clog_reader_next(clog_reader_t *r, clog_event_t *ev);
+void clog_reader_close(clog_reader_t *r);
+
+#endif
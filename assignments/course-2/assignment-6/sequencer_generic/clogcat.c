@@ -0,0 +1,135 @@
+/**
+ * File: clogcat.c
+ * Author: Brad Waggle
+ * Description: Prints a clog run log as the text run log, or its
+ *              statistics.
+ * Date: October 18, 2026
+ */
+
+// Decodes a syslog-prog-<course>.<assignment>.clog file written with
+// log_run_open_compact() and prints the lines the text run log would have
+// held, so grep, logstat and the rest read it as before:
+//
+//   clogcat syslog-prog-2.6.clog | ./logstat /dev/stdin
+//
+// -w keeps a window in milliseconds from the start of the run, and uses
+// the block index to start at the first block that can hold it instead
+// of decoding everything before. -s decodes without formatting and
+// prints the message count, the size per message and the decode rate.
+//
+// Usage: clogcat [-s] [-w from_ms:to_ms] run.clog
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "clog.h"
+#include "rt_time.h"
+
+// One line as format_run_line() in sys_logger.c writes it
+static void print_line(const clog_reader_t *r, const clog_event_t *ev) {
+    static time_t stamp_sec = -1;
+    static char stamp[32], zone[8];
+    char msg[512];
+    const char *text = ev->text;
+    time_t sec = ev->ts_ns / 1000000000ULL;
+    struct tm tm;
+    int len;
+
+    // localtime_r() once per second of log, not per line
+    if (sec != stamp_sec) {
+        localtime_r(&sec, &tm);
+        strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &tm);
+        strftime(zone, sizeof(zone), "%z", &tm);
+        stamp_sec = sec;
+    }
+
+    if (text == NULL) {
+        log_format_args(msg, sizeof(msg), ev->fmt, ev->args);
+        text = msg;
+    }
+    len = strlen(text);
+    while (len > 0 && text[len - 1] == '\n')
+        len--;
+
+    printf("%s.%06llu%.3s:%s %s %s[%u]: [COURSE:%d][ASSIGNMENT:%d]: %.*s\n", stamp,
+           (unsigned long long)(ev->ts_ns % 1000000000ULL) / 1000, zone, zone + 3, r->header->host,
+           r->header->ident, r->header->pid, ev->course, ev->assignment, len, text);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long long from_ns = 0, to_ns = ~0ULL, messages = 0, formatted = 0, start, elapsed;
+    double from_ms, to_ms;
+    clog_reader_t r;
+    clog_event_t ev;
+    int opt, stats = 0, rc;
+
+    while ((opt = getopt(argc, argv, "sw:")) != -1) {
+        switch (opt) {
+        case 's':
+            stats = 1;
+            break;
+        case 'w':
+            if (sscanf(optarg, "%lf:%lf", &from_ms, &to_ms) != 2 || to_ms < from_ms) {
+                printf("Window is from_ms:to_ms\n");
+                return -1;
+            }
+            from_ns = from_ms * 1e6;
+            to_ns = to_ms * 1e6;
+            break;
+        default:
+            printf("Usage: %s [-s] [-w from_ms:to_ms] run.clog\n", argv[0]);
+            return -1;
+        }
+    }
+    if (optind >= argc) {
+        printf("Usage: %s [-s] [-w from_ms:to_ms] run.clog\n", argv[0]);
+        return -1;
+    }
+
+    if (clog_reader_open(&r, argv[optind]))
+        return -1;
+
+    // Window times are from the start of the run
+    from_ns += r.header->start_ns;
+    to_ns = (to_ns == ~0ULL) ? to_ns : to_ns + r.header->start_ns;
+    if (from_ns > r.header->start_ns && clog_reader_seek(&r, from_ns)) {
+        printf("%s: damaged before the window\n", argv[optind]);
+        clog_reader_close(&r);
+        return -1;
+    }
+
+    start = rt_time_mono();
+    while ((rc = clog_reader_next(&r, &ev)) > 0) {
+        if (ev.ts_ns < from_ns || ev.ts_ns > to_ns) {
+            // A block that starts past the window ends it
+            if (ev.ts_ns > to_ns && r.index[r.block - 1].first_ns > to_ns)
+                break;
+            continue;
+        }
+        messages++;
+        formatted += (ev.text == NULL);
+        if (!stats)
+            print_line(&r, &ev);
+    }
+    elapsed = rt_time_mono() - start;
+
+    if (rc < 0)
+        fprintf(stderr, "%s: damaged in block %u, stopped there\n", argv[optind], r.block);
+
+    if (stats) {
+        printf("%s: %llu bytes, %u blocks, %s\n", argv[optind], (unsigned long long)r.size, r.blocks,
+               r.defs_complete ? "indexed" : "no footer, blocks found by their headers");
+        printf("  %llu messages, %llu formatted, %.1f bytes per message\n", messages, formatted,
+               messages ? (double)r.size / messages : 0.0);
+        printf("  decoded in %.3f ms, %.1f million messages/s\n", elapsed / 1e6,
+               elapsed ? messages * 1e3 / elapsed : 0.0);
+    }
+
+    clog_reader_close(&r);
+    return (rc < 0) ? -1 : 0;
+}
@@ -0,0 +1,221 @@
+/**
+ * File: coro_bench.c
+ * Author: Brad Waggle
+ * Description: Compares release/switch cost and memory footprint of
+ *              coroutine services against one pthread per service.
+ * Date: October 18, 2026
+ */
+
+// Both variants run the same token ring on one core: service i is released,
+// releases service i+1 and waits for its next release. With pthreads every
+// hop is a sem_post/sem_wait pair and a kernel context switch. With
+// coroutines every hop is two user-space switches through the scheduler.
+//
+// The default of 128 services matches the course-1 assignment-4 program that
+// pins 128 SCHED_FIFO threads to one core.
+//
+// Usage: coro_bench [services] [hops]
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <time.h>
+#include "coro_sched.h"
+
+#define DEFAULT_SERVICES (128)
+#define DEFAULT_HOPS (1000000)
+#define BENCH_CPU (0)
+
+static int num_services;
+static long num_hops;
+static atomic_long hops_left;
+static double end_time;         // set by the service that takes the last hop
+static atomic_int end_done;     // published after end_time, read with acquire
+
+static sem_t *thread_sems;
+static coro_t *coros;
+
+static double now_sec(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1000000000.0);
+}
+
+// Resident set size in KiB from /proc/self/status
+static long rss_kib(void) {
+    char line[128];
+    long kib = -1;
+    FILE *status = fopen("/proc/self/status", "r");
+
+    if (status == NULL)
+        return -1;
+
+    while (fgets(line, sizeof(line), status) != NULL)
+        if (sscanf(line, "VmRSS: %ld kB", &kib) == 1)
+            break;
+
+    fclose(status);
+    return kib;
+}
+
+// Token ring service as a pthread
+static void *thread_service(void *threadp) {
+    int idx = (int)(long)threadp;
+    int next = (idx + 1) % num_services;
+    long left;
+
+    for (;;) {
+        sem_wait(&thread_sems[idx]);
+        left = atomic_fetch_sub(&hops_left, 1);
+        if (left == 1) {
+            end_time = now_sec();
+            atomic_store_explicit(&end_done, 1, memory_order_release);
+        }
+
+        sem_post(&thread_sems[next]);
+        if (left <= 0)
+            break;                              // the stop travels once round the ring
+    }
+
+    return NULL;
+}
+
+// Token ring service as a coroutine
+static void coro_service(void *arg) {
+    int idx = (int)(long)arg;
+    int next = (idx + 1) % num_services;
+    long left;
+
+    while (coro_wait_release()) {
+        left = atomic_fetch_sub(&hops_left, 1);
+        if (left == 1) {
+            end_time = now_sec();
+            atomic_store_explicit(&end_done, 1, memory_order_release);
+        }
+        if (left > 1)
+            coro_release(&coros[next]);
+    }
+}
+
+static void bench_pthreads(void) {
+    pthread_t *threads = calloc(num_services, sizeof(pthread_t));
+    pthread_attr_t attr;
+    struct sched_param param;
+    cpu_set_t cpuset;
+    size_t stack_size;
+    long rss_before, rss_after;
+    double start, elapsed;
+    int i, rc;
+
+    thread_sems = calloc(num_services, sizeof(sem_t));
+    for (i = 0; i < num_services; i++)
+        sem_init(&thread_sems[i], 0, 0);
+
+    CPU_ZERO(&cpuset);
+    CPU_SET(BENCH_CPU, &cpuset);
+    pthread_attr_init(&attr);
+    pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuset);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+    pthread_attr_setschedparam(&attr, &param);
+    pthread_attr_getstacksize(&attr, &stack_size);
+
+    atomic_store(&hops_left, num_hops);
+    atomic_store(&end_done, 0);
+    rss_before = rss_kib();
+
+    for (i = 0; i < num_services; i++) {
+        rc = pthread_create(&threads[i], &attr, thread_service, (void *)(long)i);
+        if (rc != 0 && i == 0) {
+            printf("No RT privilege, pthread services run SCHED_OTHER\n");
+            pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+            rc = pthread_create(&threads[i], &attr, thread_service, (void *)(long)i);
+        }
+        if (rc != 0) {
+            printf("pthread_create for service %d failed\n", i);
+            exit(-1);
+        }
+    }
+
+    usleep(100000);
+    rss_after = rss_kib();
+
+    start = now_sec();
+    sem_post(&thread_sems[0]);
+    for (i = 0; i < num_services; i++)
+        pthread_join(threads[i], NULL);
+    elapsed = end_time - start;
+
+    printf("pthread:   %d services, %ld hops, %.1f ns/release, stack reserved %zu KiB/service, RSS +%ld KiB (%.1f KiB/service)\n",
+           num_services, num_hops, (elapsed * 1e9) / num_hops, stack_size / 1024,
+           rss_after - rss_before, (double)(rss_after - rss_before) / num_services);
+
+    for (i = 0; i < num_services; i++)
+        sem_destroy(&thread_sems[i]);
+    pthread_attr_destroy(&attr);
+    free(thread_sems);
+    free(threads);
+}
+
+static void bench_coroutines(void) {
+    coro_sched_t sched;
+    long rss_before, rss_after;
+    double start, elapsed;
+    int i;
+
+    coros = calloc(num_services, sizeof(coro_t));
+    coro_sched_init(&sched);
+
+    atomic_store(&hops_left, num_hops);
+    atomic_store(&end_done, 0);
+    rss_before = rss_kib();
+
+    // Equal priorities keep the ring order, as with the equal-priority threads
+    for (i = 0; i < num_services; i++)
+        coro_create(&sched, &coros[i], "ring", 1, coro_service, (void *)(long)i, CORO_STACK_SIZE);
+
+    rss_after = rss_kib();
+
+    coro_sched_start(&sched, BENCH_CPU, sched_get_priority_max(SCHED_FIFO) - 1);
+
+    start = now_sec();
+    coro_release(&coros[0]);
+    // hops_left reaches 0 before end_time is written, wait for the flag
+    while (!atomic_load_explicit(&end_done, memory_order_acquire))
+        usleep(1000);
+    elapsed = end_time - start;
+
+    coro_sched_stop(&sched);
+
+    printf("coroutine: %d services, %ld hops, %.1f ns/release (%.1f ns/switch), stack %d KiB/service prefaulted, RSS +%ld KiB (%.1f KiB/service)\n",
+           num_services, num_hops, (elapsed * 1e9) / num_hops, (elapsed * 1e9) / sched.switches,
+           CORO_STACK_SIZE / 1024, rss_after - rss_before, (double)(rss_after - rss_before) / num_services);
+
+    for (i = 0; i < num_services; i++)
+        coro_destroy(&coros[i]);
+    free(coros);
+}
+
+int main(int argc, char *argv[])
+{
+    num_services = (argc > 1) ? atoi(argv[1]) : DEFAULT_SERVICES;
+    num_hops = (argc > 2) ? atol(argv[2]) : DEFAULT_HOPS;
+
+    if (num_services < 1 || num_services > CORO_MAX) {
+        printf("services must be 1..%d\n", CORO_MAX);
+        return -1;
+    }
+
+    bench_pthreads();
+    bench_coroutines();
+
+    return 0;
+}
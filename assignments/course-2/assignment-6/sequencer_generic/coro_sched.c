@@ -0,0 +1,396 @@
+/**
+ * File: coro_sched.c
+ * Author: Brad Waggle
+ * Description: Lightweight services run as user-space coroutines, scheduled
+ *              by priority inside a single SCHED_FIFO thread per core.
+ * Date: October 18, 2026
+ */
+
+// A thread per service costs a full stack and a kernel scheduling entity,
+// and every release is a futex wake plus a kernel context switch. Here many
+// short services share one RT thread: a release sets a bit in a ready
+// bitmap ordered by priority, and the scheduler loop switches to the
+// highest priority ready coroutine by swapping a handful of callee-saved
+// registers. Nothing enters the kernel unless the scheduler has nothing to
+// run and sleeps on its semaphore.
+//
+// Scheduling between coroutines is run-to-completion: a release of a higher
+// priority coroutine is picked up when the running one calls
+// coro_wait_release(), so each coroutine body must be short compared to
+// the shortest period on that core. Preemption between cores and against
+// other threads is still done by SCHED_FIFO.
+//
+// The context switch is a few instructions of assembly on x86-64 and
+// AArch64; other targets fall back to ucontext, which also saves the
+// signal mask and is much slower.
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "coro_sched.h"
+
+// Scheduler owned by the calling thread, NULL outside a scheduler thread
+static __thread coro_sched_t *this_sched;
+
+static void coro_trampoline(void);
+
+#if defined(__x86_64__)
+
+// Save rbp, rbx, r12-r15, MXCSR and the x87 control word on the current
+// stack, store rsp in *save_sp and resume the context saved at new_sp
+void coro_switch(void **save_sp, void *new_sp);
+__asm__(
+    ".text\n"
+    ".globl coro_switch\n"
+    ".hidden coro_switch\n"
+    ".type coro_switch, @function\n"
+    "coro_switch:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $8, %rsp\n"
+    "    stmxcsr (%rsp)\n"
+    "    fnstcw 4(%rsp)\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw 4(%rsp)\n"
+    "    addq $8, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".size coro_switch, .-coro_switch\n");
+
+// Build a frame that coro_switch() "returns" into coro_trampoline from
+static void ctx_make(coro_ctx_t *ctx, void *stack, size_t size) {
+    uint64_t *sp = (uint64_t *)(((uintptr_t)stack + size) & ~(uintptr_t)15);
+    int i;
+
+    *--sp = 0;                              // keeps the ABI alignment at entry
+    *--sp = (uint64_t)coro_trampoline;      // return address
+    for (i = 0; i < 6; i++)
+        *--sp = 0;                          // rbp, rbx, r12-r15
+    --sp;
+    __asm__ volatile("stmxcsr (%0)\n\tfnstcw 4(%0)" : : "r"(sp) : "memory");
+
+    ctx->sp = sp;
+}
+
+static inline void ctx_switch(coro_ctx_t *from, coro_ctx_t *to) {
+    coro_switch(&from->sp, to->sp);
+}
+
+#elif defined(__aarch64__)
+
+// Save x19-x30 and d8-d15 on the current stack, store sp in *save_sp and
+// resume the context saved at new_sp
+void coro_switch(void **save_sp, void *new_sp);
+__asm__(
+    ".text\n"
+    ".globl coro_switch\n"
+    ".hidden coro_switch\n"
+    ".type coro_switch, %function\n"
+    "coro_switch:\n"
+    "    sub sp, sp, #160\n"
+    "    stp x19, x20, [sp, #0]\n"
+    "    stp x21, x22, [sp, #16]\n"
+    "    stp x23, x24, [sp, #32]\n"
+    "    stp x25, x26, [sp, #48]\n"
+    "    stp x27, x28, [sp, #64]\n"
+    "    stp x29, x30, [sp, #80]\n"
+    "    stp d8, d9, [sp, #96]\n"
+    "    stp d10, d11, [sp, #112]\n"
+    "    stp d12, d13, [sp, #128]\n"
+    "    stp d14, d15, [sp, #144]\n"
+    "    mov x2, sp\n"
+    "    str x2, [x0]\n"
+    "    mov sp, x1\n"
+    "    ldp x19, x20, [sp, #0]\n"
+    "    ldp x21, x22, [sp, #16]\n"
+    "    ldp x23, x24, [sp, #32]\n"
+    "    ldp x25, x26, [sp, #48]\n"
+    "    ldp x27, x28, [sp, #64]\n"
+    "    ldp x29, x30, [sp, #80]\n"
+    "    ldp d8, d9, [sp, #96]\n"
+    "    ldp d10, d11, [sp, #112]\n"
+    "    ldp d12, d13, [sp, #128]\n"
+    "    ldp d14, d15, [sp, #144]\n"
+    "    add sp, sp, #160\n"
+    "    ret\n"
+    ".size coro_switch, .-coro_switch\n");
+
+// Build a frame whose saved link register is coro_trampoline
+static void ctx_make(coro_ctx_t *ctx, void *stack, size_t size) {
+    uint64_t *sp = (uint64_t *)((((uintptr_t)stack + size) & ~(uintptr_t)15) - 160);
+
+    memset(sp, 0, 160);
+    sp[11] = (uint64_t)coro_trampoline;     // x30
+
+    ctx->sp = sp;
+}
+
+static inline void ctx_switch(coro_ctx_t *from, coro_ctx_t *to) {
+    coro_switch(&from->sp, to->sp);
+}
+
+#else
+
+static void ctx_make(coro_ctx_t *ctx, void *stack, size_t size) {
+    getcontext(&ctx->uc);
+    ctx->uc.uc_stack.ss_sp = stack;
+    ctx->uc.uc_stack.ss_size = size;
+    ctx->uc.uc_link = NULL;
+    makecontext(&ctx->uc, coro_trampoline, 0);
+}
+
+static inline void ctx_switch(coro_ctx_t *from, coro_ctx_t *to) {
+    swapcontext(&from->uc, &to->uc);
+}
+
+#endif
+
+// First code run on a coroutine's stack, never returns
+static void coro_trampoline(void) {
+    coro_sched_t *sched = this_sched;
+    coro_t *coro = sched->current;
+
+    coro->fn(coro->arg);
+
+    coro->done = 1;
+    ctx_switch(&coro->ctx, &sched->ctx);
+}
+
+static inline void set_ready(coro_sched_t *sched, int slot) {
+    atomic_fetch_or_explicit(&sched->ready[slot >> 6], 1ULL << (slot & 63), memory_order_release);
+}
+
+static inline void clear_ready(coro_sched_t *sched, int slot) {
+    atomic_fetch_and_explicit(&sched->ready[slot >> 6], ~(1ULL << (slot & 63)), memory_order_relaxed);
+}
+
+// Lowest set bit is the highest priority ready coroutine, -1 if none
+static inline int next_ready(coro_sched_t *sched) {
+    unsigned long long bits;
+    int w;
+
+    for (w = 0; w < CORO_READY_WORDS; w++) {
+        bits = atomic_load_explicit(&sched->ready[w], memory_order_acquire);
+        if (bits)
+            return (w * 64) + __builtin_ctzll(bits);
+    }
+
+    return -1;
+}
+
+// Consume one release, keeping the ready bit in step with pending
+static int take_release(coro_sched_t *sched, coro_t *coro) {
+    unsigned int pending = atomic_load_explicit(&coro->pending, memory_order_acquire);
+
+    while (pending > 0 &&
+           !atomic_compare_exchange_weak_explicit(&coro->pending, &pending, pending - 1,
+                                                  memory_order_acquire, memory_order_relaxed))
+        ;
+
+    if (pending <= 1) {
+        clear_ready(sched, coro->slot);
+        // A release may have landed between the decrement and the clear
+        if (atomic_load_explicit(&coro->pending, memory_order_acquire) > 0)
+            set_ready(sched, coro->slot);
+    }
+
+    return pending > 0;
+}
+
+static inline void dispatch(coro_sched_t *sched, coro_t *coro) {
+    sched->current = coro;
+    ctx_switch(&sched->ctx, &coro->ctx);
+    sched->current = NULL;
+    sched->switches += 2;
+}
+
+int coro_sched_init(coro_sched_t *sched) {
+    memset(sched, 0, sizeof(*sched));
+
+    if (sem_init(&sched->wake, 0, 0)) {
+        printf("Failed to initialize coroutine scheduler semaphore\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+// Add a coroutine, all coroutines must be created before the scheduler runs.
+// The stack is mapped with a guard page and prefaulted.
+int coro_create(coro_sched_t *sched, coro_t *coro, const char *name, int priority,
+                coro_fn_t fn, void *arg, size_t stack_size) {
+    long page_size = sysconf(_SC_PAGESIZE);
+    unsigned char *map;
+    int i;
+
+    if (sched->num_coros >= CORO_MAX) {
+        printf("Too many coroutines on one scheduler\n");
+        return -1;
+    }
+
+    if (stack_size == 0)
+        stack_size = CORO_STACK_SIZE;
+    stack_size = (stack_size + page_size - 1) & ~(size_t)(page_size - 1);
+
+    map = mmap(NULL, stack_size + page_size, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    if (map == MAP_FAILED) {
+        perror("coroutine stack mmap");
+        return -1;
+    }
+    mprotect(map, page_size, PROT_NONE);
+    memset(map + page_size, 0, stack_size);
+
+    memset(coro, 0, sizeof(*coro));
+    coro->name = name;
+    coro->priority = priority;
+    coro->fn = fn;
+    coro->arg = arg;
+    coro->stack = map;
+    coro->stack_size = stack_size;
+    coro->sched = sched;
+    atomic_init(&coro->pending, 0);
+    ctx_make(&coro->ctx, map + page_size, stack_size);
+
+    // Keep coros[] ordered by priority so the ready bitmap is too
+    for (i = sched->num_coros; i > 0 && sched->coros[i - 1]->priority < priority; i--) {
+        sched->coros[i] = sched->coros[i - 1];
+        sched->coros[i]->slot = i;
+    }
+    sched->coros[i] = coro;
+    coro->slot = i;
+    sched->num_coros++;
+
+    return 0;
+}
+
+// Scheduler loop, runs in the calling thread until coro_sched_stop()
+void coro_sched_run(coro_sched_t *sched) {
+    coro_t *coro;
+    int i, slot;
+
+    this_sched = sched;
+
+    // Run every coroutine's setup up to its first coro_wait_release()
+    for (i = 0; i < sched->num_coros; i++)
+        dispatch(sched, sched->coros[i]);
+
+    while (!atomic_load_explicit(&sched->stop, memory_order_acquire)) {
+        slot = next_ready(sched);
+        if (slot < 0) {
+            while (sem_wait(&sched->wake) != 0 && errno == EINTR)
+                ;
+            continue;
+        }
+
+        coro = sched->coros[slot];
+        if (coro->done) {
+            clear_ready(sched, slot);
+            continue;
+        }
+
+        if (take_release(sched, coro)) {
+            coro->runs++;
+            dispatch(sched, coro);
+        }
+    }
+
+    // Resume each coroutine once more so it sees the stop and returns
+    sched->stopping = 1;
+    for (i = 0; i < sched->num_coros; i++)
+        if (!sched->coros[i]->done)
+            dispatch(sched, sched->coros[i]);
+
+    this_sched = NULL;
+}
+
+static void *coro_sched_thread(void *threadp) {
+    coro_sched_run((coro_sched_t *)threadp);
+    return NULL;
+}
+
+// Run the scheduler on its own SCHED_FIFO thread pinned to cpu
+int coro_sched_start(coro_sched_t *sched, int cpu, int rt_priority) {
+    pthread_attr_t attr;
+    struct sched_param param;
+    cpu_set_t cpuset;
+    int rc;
+
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    param.sched_priority = rt_priority;
+    pthread_attr_setschedparam(&attr, &param);
+    pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuset);
+
+    rc = pthread_create(&sched->thread, &attr, coro_sched_thread, (void *)sched);
+    if (rc == EPERM) {
+        printf("No RT privilege, coroutine scheduler runs SCHED_OTHER\n");
+        pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+        rc = pthread_create(&sched->thread, &attr, coro_sched_thread, (void *)sched);
+    }
+
+    pthread_attr_destroy(&attr);
+
+    if (rc != 0) {
+        printf("pthread_create for coroutine scheduler failed: %s\n", strerror(rc));
+        return -1;
+    }
+
+    return 0;
+}
+
+void coro_sched_stop(coro_sched_t *sched) {
+    atomic_store_explicit(&sched->stop, 1, memory_order_release);
+    sem_post(&sched->wake);
+    pthread_join(sched->thread, NULL);
+    sem_destroy(&sched->wake);
+}
+
+void coro_destroy(coro_t *coro) {
+    munmap(coro->stack, coro->stack_size + sysconf(_SC_PAGESIZE));
+    coro->stack = NULL;
+}
+
+// Release a coroutine, callable from any thread including other coroutines
+void coro_release(coro_t *coro) {
+    coro_sched_t *sched = coro->sched;
+
+    atomic_fetch_add_explicit(&coro->pending, 1, memory_order_release);
+    set_ready(sched, coro->slot);
+
+    // Only a release from outside needs to wake the scheduler thread
+    if (this_sched != sched)
+        sem_post(&sched->wake);
+}
+
+// Called in a coroutine's loop: yields to the scheduler and returns once the
+// coroutine has been released again, or 0 when the scheduler is stopping
+int coro_wait_release(void) {
+    coro_sched_t *sched = this_sched;
+    coro_t *coro = sched->current;
+
+    ctx_switch(&coro->ctx, &sched->ctx);
+
+    return !sched->stopping;
+}
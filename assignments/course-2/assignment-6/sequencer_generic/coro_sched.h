@@ -0,0 +1,77 @@
+#ifndef CORO_SCHED_H
+#define CORO_SCHED_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+
+#if !defined(__x86_64__) && !defined(__aarch64__)
+#include <ucontext.h>
+#endif
+
+// Coroutines per scheduler thread, must be a multiple of 64
+#define CORO_MAX (128)
+#define CORO_READY_WORDS (CORO_MAX / 64)
+
+// Default stack per coroutine, services must be short and shallow
+#define CORO_STACK_SIZE (16 * 1024)
+
+// Saved register context of a coroutine or of the scheduler loop
+typedef struct
+{
+#if defined(__x86_64__) || defined(__aarch64__)
+    void *sp;                   // callee-saved registers live on the stack
+#else
+    ucontext_t uc;
+#endif
+} coro_ctx_t;
+
+typedef void (*coro_fn_t)(void *arg);
+
+struct coro_sched;
+
+// One lightweight service
+typedef struct
+{
+    coro_ctx_t ctx;
+    const char *name;
+    int priority;               // higher runs first, same scale as SCHED_FIFO
+    int slot;                   // position in the scheduler's priority order
+    coro_fn_t fn;
+    void *arg;
+    void *stack;                // mmap'd, lowest page is a guard page
+    size_t stack_size;
+    atomic_uint pending;        // releases not yet consumed
+    int done;
+    unsigned long long runs;    // releases consumed
+    struct coro_sched *sched;
+} coro_t;
+
+// Priority scheduler for the coroutines bound to one RT thread
+typedef struct coro_sched
+{
+    coro_t *coros[CORO_MAX];        // sorted by priority, highest first
+    int num_coros;
+    atomic_ullong ready[CORO_READY_WORDS];  // bit per slot with pending releases
+    coro_ctx_t ctx;                 // scheduler loop context
+    coro_t *current;
+    sem_t wake;                     // posted by releases from other threads
+    atomic_int stop;
+    int stopping;
+    pthread_t thread;
+    unsigned long long switches;
+} coro_sched_t;
+
+int coro_sched_init(coro_sched_t *sched);
+int coro_create(coro_sched_t *sched, coro_t *coro, const char *name, int priority,
+                coro_fn_t fn, void *arg, size_t stack_size);
+int coro_sched_start(coro_sched_t *sched, int cpu, int rt_priority);
+void coro_sched_run(coro_sched_t *sched);
+void coro_sched_stop(coro_sched_t *sched);
+void coro_destroy(coro_t *coro);
+
+void coro_release(coro_t *coro);
+int coro_wait_release(void);
+
+#endif
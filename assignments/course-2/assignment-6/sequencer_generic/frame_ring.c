@@ -0,0 +1,179 @@
+/**
+ * File: frame_ring.c
+ * Author: Brad Waggle
+ * Description: Preallocated, lock-free ring of frame slots shared between
+ *              the acquisition service and the processing services.
+ * Date: October 18, 2026
+ */
+
+// The acquisition service (single producer) claims a free slot, writes the
+// frame directly into the slot's buffer and publishes it. Publishing sets
+// the slot reference count to the number of registered stages, so every
+// stage (timestamp, difference, save, ...) reads the same buffer in place.
+// The last stage to release a slot makes it free again. Frames are never
+// copied between stages and no locks are taken on either side.
+//
+// When every slot is still referenced the producer's claim fails and the
+// overrun is counted rather than overwriting a frame a stage is reading.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "frame_ring.h"
+
+// Preallocate, prefault and lock the frame store
+int frame_ring_init(frame_ring_t *ring, size_t frame_size) {
+    int i;
+    long page_size = sysconf(_SC_PAGESIZE);
+    size_t store_size = frame_size * FRAME_RING_SLOTS;
+
+    memset(ring, 0, sizeof(*ring));
+
+    if (posix_memalign((void **)&ring->store, page_size, store_size) != 0) {
+        printf("Failed to allocate frame ring store\n");
+        return -1;
+    }
+
+    // Touch every page now so acquisition never takes a page fault
+    memset(ring->store, 0, store_size);
+    if (mlock(ring->store, store_size) != 0)
+        perror("frame_ring mlock");
+
+    ring->frame_size = frame_size;
+    atomic_init(&ring->head, 0);
+
+    for (i = 0; i < FRAME_RING_SLOTS; i++) {
+        ring->slots[i].data = ring->store + (i * frame_size);
+        atomic_init(&ring->slots[i].refcnt, 0);
+        atomic_init(&ring->slots[i].published, 0);
+    }
+
+    return 0;
+}
+
+void frame_ring_destroy(frame_ring_t *ring) {
+    munlock(ring->store, ring->frame_size * FRAME_RING_SLOTS);
+    free(ring->store);
+    ring->store = NULL;
+}
+
+// Register a consumer stage, must be done before the producer starts
+int frame_ring_add_stage(frame_ring_t *ring, const char *name) {
+    int stage;
+
+    if (ring->num_stages >= FRAME_RING_MAX_STAGES) {
+        printf("Too many frame ring stages\n");
+        return -1;
+    }
+
+    stage = ring->num_stages++;
+    ring->stages[stage].name = name;
+    atomic_init(&ring->stages[stage].next, 1);
+
+    return stage;
+}
+
+// Claim the next slot for writing, NULL if the stages have not released it yet
+frame_slot_t *frame_ring_claim(frame_ring_t *ring) {
+    unsigned long long seq = atomic_load_explicit(&ring->head, memory_order_relaxed) + 1;
+    frame_slot_t *slot = &ring->slots[seq & FRAME_RING_MASK];
+    int expected = 0;
+
+    if (!atomic_compare_exchange_strong_explicit(&slot->refcnt, &expected, FRAME_SLOT_CLAIMED,
+                                                 memory_order_acquire, memory_order_relaxed)) {
+        ring->overruns++;
+        return NULL;
+    }
+
+    slot->seq = seq;
+    return slot;
+}
+
+// Make a claimed slot visible to every registered stage
+void frame_ring_publish(frame_ring_t *ring, frame_slot_t *slot, size_t size) {
+    slot->size = size;
+    clock_gettime(CLOCK_MONOTONIC, &slot->timestamp);
+
+    atomic_store_explicit(&slot->refcnt, ring->num_stages, memory_order_relaxed);
+    atomic_store_explicit(&slot->published, slot->seq, memory_order_release);
+    atomic_store_explicit(&ring->head, slot->seq, memory_order_release);
+    ring->produced++;
+}
+
+// Track the worst backlog a stage has seen
+static void update_lag(frame_ring_t *ring, int stage, unsigned long long head) {
+    frame_stage_t *st = &ring->stages[stage];
+    unsigned long long next = atomic_load_explicit(&st->next, memory_order_relaxed);
+    unsigned long long lag = (head >= next) ? (head - next + 1) : 0;
+
+    if (lag > st->max_lag)
+        st->max_lag = lag;
+}
+
+// Get the next frame in order for a stage, NULL if none is ready
+frame_slot_t *frame_ring_acquire(frame_ring_t *ring, int stage) {
+    frame_stage_t *st = &ring->stages[stage];
+    unsigned long long next = atomic_load_explicit(&st->next, memory_order_relaxed);
+    frame_slot_t *slot = &ring->slots[next & FRAME_RING_MASK];
+
+    update_lag(ring, stage, atomic_load_explicit(&ring->head, memory_order_acquire));
+
+    if (atomic_load_explicit(&slot->published, memory_order_acquire) != next)
+        return NULL;
+
+    atomic_store_explicit(&st->next, next + 1, memory_order_relaxed);
+    st->consumed++;
+    return slot;
+}
+
+// Get the newest frame for a stage, releasing any older frames it skips.
+// Used by stages that run slower than acquisition and only want the latest.
+frame_slot_t *frame_ring_acquire_latest(frame_ring_t *ring, int stage) {
+    frame_stage_t *st = &ring->stages[stage];
+    unsigned long long head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    unsigned long long next = atomic_load_explicit(&st->next, memory_order_relaxed);
+
+    update_lag(ring, stage, head);
+
+    if (next > head)
+        return NULL;
+
+    // The stage still holds a reference on every frame it has not read
+    for (; next < head; next++) {
+        frame_ring_release(ring, &ring->slots[next & FRAME_RING_MASK]);
+        st->skipped++;
+    }
+
+    atomic_store_explicit(&st->next, head + 1, memory_order_relaxed);
+    st->consumed++;
+    return &ring->slots[head & FRAME_RING_MASK];
+}
+
+// Drop a stage's reference, the last reader recycles the slot
+void frame_ring_release(frame_ring_t *ring, frame_slot_t *slot) {
+    atomic_fetch_sub_explicit(&slot->refcnt, 1, memory_order_release);
+}
+
+// Number of published frames a stage has not read yet
+unsigned long long frame_ring_lag(frame_ring_t *ring, int stage) {
+    unsigned long long head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    unsigned long long next = atomic_load_explicit(&ring->stages[stage].next, memory_order_relaxed);
+
+    return (head >= next) ? (head - next + 1) : 0;
+}
+
+void frame_ring_report(frame_ring_t *ring) {
+    int i;
+    frame_stage_t *st;
+
+    printf("Frame ring: %d slots of %zu bytes, produced=%llu, overruns=%llu\n",
+           FRAME_RING_SLOTS, ring->frame_size, ring->produced, ring->overruns);
+
+    for (i = 0; i < ring->num_stages; i++) {
+        st = &ring->stages[i];
+        printf("  stage %d %-12s consumed=%llu skipped=%llu lag=%llu max_lag=%llu\n",
+               i, st->name, st->consumed, st->skipped, frame_ring_lag(ring, i), st->max_lag);
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <stddef.h>
+#include <time.h>
+#include <stdatomic.h>
+
+// Number of frame slots in the ring, must be a power of 2
+#define FRAME_RING_SLOTS (8)
+#define FRAME_RING_MASK (FRAME_RING_SLOTS - 1)
+
+// Maximum number of consumer stages (e.g. timestamp, difference, save)
+#define FRAME_RING_MAX_STAGES (8)
+
+// Slot reference count while the producer is writing into it
+#define FRAME_SLOT_CLAIMED (-1)
+
+// One preallocated frame buffer shared by the producer and all stages
+typedef struct
+{
+    unsigned char *data;            // points into the ring's frame store, never copied
+    size_t size;                    // number of valid bytes in data
+    unsigned long long seq;         // frame sequence number, starts at 1
+    struct timespec timestamp;      // CLOCK_MONOTONIC time the frame was published
+    atomic_int refcnt;              // readers still holding the frame, 0 when free
+    atomic_ullong published;        // seq once readable by the stages
+} frame_slot_t;
+
+// Per consumer stage cursor and statistics
+typedef struct
+{
+    const char *name;
+    atomic_ullong next;             // next sequence number this stage will read
+    unsigned long long consumed;    // frames handed to the stage
+    unsigned long long skipped;     // frames released unread by frame_ring_acquire_latest
+    unsigned long long max_lag;     // worst backlog seen by the stage
+} frame_stage_t;
+
+typedef struct
+{
+    frame_slot_t slots[FRAME_RING_SLOTS];
+    frame_stage_t stages[FRAME_RING_MAX_STAGES];
+    int num_stages;
+    unsigned char *store;           // FRAME_RING_SLOTS * frame_size bytes
+    size_t frame_size;
+    atomic_ullong head;             // last published sequence number
+    unsigned long long produced;    // frames published
+    unsigned long long overruns;    // claims refused because the slot was still in use
+} frame_ring_t;
+
+int frame_ring_init(frame_ring_t *ring, size_t frame_size);
+void frame_ring_destroy(frame_ring_t *ring);
+int frame_ring_add_stage(frame_ring_t *ring, const char *name);
+
+frame_slot_t *frame_ring_claim(frame_ring_t *ring);
+void frame_ring_publish(frame_ring_t *ring, frame_slot_t *slot, size_t size);
+
+frame_slot_t *frame_ring_acquire(frame_ring_t *ring, int stage);
+frame_slot_t *frame_ring_acquire_latest(frame_ring_t *ring, int stage);
+void frame_ring_release(frame_ring_t *ring, frame_slot_t *slot);
+
+unsigned long long frame_ring_lag(frame_ring_t *ring, int stage);
+void frame_ring_report(frame_ring_t *ring);
+
+#endif
@@ -0,0 +1,115 @@
+/**
+ * File: hdr_hist.c
+ * Author: Brad Waggle
+ * Description: Log-linear latency histograms in the style of HdrHistogram.
+ * Date: October 18, 2026
+ */
+
+// Values below HDR_SUB_BUCKETS ns get a bucket each. Above that every power
+// of two is split into HDR_SUB_BUCKETS equal buckets, so a bucket is never
+// wider than 1/HDR_SUB_BUCKETS of the values in it. The bucket index is a
+// count-leading-zeros and two shifts, recording is a handful of relaxed
+// loads and stores with no lock, no loop and no allocation. That only holds
+// for a single recording thread, which is how the services use it: each
+// histogram belongs to one service thread.
+//
+// Readers see the buckets as they are, a percentile taken while a release
+// is being recorded may be off by that one release. Percentiles report the
+// top of their bucket, as HdrHistogram does, so they never understate.
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include "hdr_hist.h"
+
+void hdr_hist_init(hdr_hist_t *h, const char *name) {
+    memset(h, 0, sizeof(*h));
+    h->name = name;
+    atomic_init(&h->min_ns, ~0ULL);
+}
+
+static int bucket_of(unsigned long long ns) {
+    int msb, idx;
+
+    if (ns < HDR_SUB_BUCKETS)
+        return (int)ns;
+
+    msb = 63 - __builtin_clzll(ns);
+    idx = HDR_SUB_BUCKETS * (msb - HDR_SUB_BITS + 1) + (int)(ns >> (msb - HDR_SUB_BITS)) - HDR_SUB_BUCKETS;
+    return (idx < HDR_BUCKETS) ? idx : HDR_BUCKETS - 1;
+}
+
+// Largest value that falls in a bucket
+static unsigned long long bucket_top(int idx) {
+    int shift;
+
+    if (idx < HDR_SUB_BUCKETS)
+        return idx;
+
+    shift = idx / HDR_SUB_BUCKETS - 1;
+    return ((unsigned long long)(HDR_SUB_BUCKETS + idx % HDR_SUB_BUCKETS + 1) << shift) - 1;
+}
+
+// Single writer increment, no locked instruction
+static inline void bump(atomic_ullong *v, unsigned long long by) {
+    atomic_store_explicit(v, atomic_load_explicit(v, memory_order_relaxed) + by, memory_order_relaxed);
+}
+
+// Constant time, call only from the thread that owns the histogram
+void hdr_hist_record(hdr_hist_t *h, unsigned long long ns) {
+    bump(&h->buckets[bucket_of(ns)], 1);
+    bump(&h->sum_ns, ns);
+    if (ns < atomic_load_explicit(&h->min_ns, memory_order_relaxed))
+        atomic_store_explicit(&h->min_ns, ns, memory_order_relaxed);
+    if (ns > atomic_load_explicit(&h->max_ns, memory_order_relaxed))
+        atomic_store_explicit(&h->max_ns, ns, memory_order_relaxed);
+
+    // Count last, so a reader never sees more values counted than bucketed
+    atomic_store_explicit(&h->count, atomic_load_explicit(&h->count, memory_order_relaxed) + 1,
+                          memory_order_release);
+}
+
+// Value at or below which pct percent of the recorded values fall, 0 when empty
+unsigned long long hdr_hist_percentile(hdr_hist_t *h, double pct) {
+    unsigned long long count = atomic_load_explicit(&h->count, memory_order_acquire);
+    unsigned long long target, seen = 0, top, max;
+    int i;
+
+    if (count == 0)
+        return 0;
+
+    target = (unsigned long long)(count * pct / 100.0 + 0.5);
+    if (target < 1)
+        target = 1;
+    if (target > count)
+        target = count;
+
+    max = atomic_load_explicit(&h->max_ns, memory_order_relaxed);
+    for (i = 0; i < HDR_BUCKETS; i++) {
+        seen += atomic_load_explicit(&h->buckets[i], memory_order_relaxed);
+        if (seen >= target) {
+            top = bucket_top(i);
+            return (top < max) ? top : max;
+        }
+    }
+
+    return max;
+}
+
+// One line summary in microseconds, returns its length as snprintf does
+int hdr_hist_format(hdr_hist_t *h, char *buf, size_t size) {
+    unsigned long long count = atomic_load_explicit(&h->count, memory_order_acquire);
+
+    if (count == 0)
+        return snprintf(buf, size, "%-18s n=0", h->name);
+
+    return snprintf(buf, size, "%-18s n=%llu min=%.1f p50=%.1f p99=%.1f p99.99=%.1f max=%.1f mean=%.1f us",
+                    h->name, count,
+                    atomic_load_explicit(&h->min_ns, memory_order_relaxed) / 1000.0,
+                    hdr_hist_percentile(h, 50.0) / 1000.0,
+                    hdr_hist_percentile(h, 99.0) / 1000.0,
+                    hdr_hist_percentile(h, 99.99) / 1000.0,
+                    atomic_load_explicit(&h->max_ns, memory_order_relaxed) / 1000.0,
+                    atomic_load_explicit(&h->sum_ns, memory_order_relaxed) / (count * 1000.0));
+}
@@ -0,0 +1,34 @@
+#ifndef HDR_HIST_H
+#define HDR_HIST_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+// Sub-buckets per power of two, as a power of 2. 7 bits keeps every
+// recorded value within 1% of its bucket.
+#define HDR_SUB_BITS (7)
+#define HDR_SUB_BUCKETS (1 << HDR_SUB_BITS)
+
+// Largest value with its own bucket is 2^HDR_MAX_BITS ns (about 68 s),
+// larger ones land in the last bucket and still set max_ns
+#define HDR_MAX_BITS (36)
+#define HDR_BUCKETS (HDR_SUB_BUCKETS * (HDR_MAX_BITS - HDR_SUB_BITS + 2))
+
+// Log-linear histogram of nanosecond values. One thread records, any
+// thread may read it at any time.
+typedef struct
+{
+    const char *name;
+    atomic_ullong count;
+    atomic_ullong sum_ns;
+    atomic_ullong min_ns;
+    atomic_ullong max_ns;
+    atomic_ullong buckets[HDR_BUCKETS];
+} hdr_hist_t;
+
+void hdr_hist_init(hdr_hist_t *h, const char *name);
+void hdr_hist_record(hdr_hist_t *h, unsigned long long ns);
+unsigned long long hdr_hist_percentile(hdr_hist_t *h, double pct);
+int hdr_hist_format(hdr_hist_t *h, char *buf, size_t size);
+
+#endif
@@ -0,0 +1,76 @@
+/**
+ * File: log_bench.c
+ * Author: Brad Waggle
+ * Description: Caller-side cost of log_sys() with the synchronous syslog
+ *              path, the queued writer and deferred formatting.
+ * Date: October 18, 2026
+ */
+
+// Logs the same Sequencer-style messages first through the old path
+// (openlog/syslog/closelog per call), then through the queue, and last
+// through log_sysf() which queues the raw arguments. The calls are paced so
+// the writer keeps up. It prints the mean and worst time a caller spends
+// formatting and logging one message for each.
+//
+// Usage: log_bench [messages] [gap_us]
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include "sys_logger.h"
+#include "rt_time.h"
+
+#define DEFAULT_MESSAGES (2000)
+#define DEFAULT_GAP_US (100)
+
+static void run(const char *name, int messages, int gap_us, int deferred) {
+    unsigned long long start, elapsed, total = 0, worst = 0;
+    char msg[128];
+    int i;
+
+    for (i = 0; i < messages; i++) {
+        start = rt_time_mono();
+        if (deferred) {
+            log_sysf(2, 6, "Thread %d start %d @ %lf on core %d \n", (i % 4) + 1, i + 1, i / 100.0, sched_getcpu());
+        } else {
+            snprintf(msg, sizeof(msg), "Thread %d start %d @ %lf on core %d \n", (i % 4) + 1, i + 1, i / 100.0, sched_getcpu());
+            log_sys(msg, 2, 6);
+        }
+        elapsed = rt_time_mono() - start;
+
+        total += elapsed;
+        if (elapsed > worst)
+            worst = elapsed;
+        usleep(gap_us);
+    }
+
+    printf("%-12s %d messages: mean %.3f us, worst %.2f us per message\n",
+           name, messages, total / (messages * 1000.0), worst / 1000.0);
+}
+
+int main(int argc, char *argv[])
+{
+    int messages = (argc > 1) ? atoi(argv[1]) : DEFAULT_MESSAGES;
+    int gap_us = (argc > 2) ? atoi(argv[2]) : DEFAULT_GAP_US;
+
+    if (messages < 1) {
+        printf("messages must be at least 1\n");
+        return -1;
+    }
+
+    run("synchronous", messages, gap_us, 0);
+
+    if (log_sys_start(NULL, LOG_OVERFLOW_DROP) != 0) {
+        printf("No syslog socket, queued backend not measured\n");
+        return -1;
+    }
+    run("queued", messages, gap_us, 0);
+    run("deferred", messages, gap_us, 1);
+    log_sys_stop();
+    log_sys_report();
+
+    return 0;
+}
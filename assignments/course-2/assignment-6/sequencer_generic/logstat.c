@@ -0,0 +1,507 @@
+/**
+ * File: logstat.c
+ * Author: Brad Waggle
+ * Description: Release period, jitter, missed release and core residency
+ *              statistics from sequencer syslog traces.
+ * Date: October 18, 2026
+ */
+
+// Takes the place of reading syslog-trace.txt and syslog-prog-C.A.txt by
+// eye. Three kinds of line are picked out of the log, everything else is
+// skipped:
+//
+//   Sequencer cycle N @ sec=S, msec=M            (seqgen, service "Sequencer")
+//   Thread N start K @ T on core C               (seqgenex0, service "S<N>")
+//   SN F Hz on core C for release R @ sec=T      (seqgen2, service "S<N>")
+//
+// For each service it reports the time between consecutive releases
+// (mean, standard deviation, percentiles and peak-to-peak jitter), how many
+// releases are missing from the sequence numbers and which cores the
+// releases ran on. The sequence step of a service is the smallest one seen,
+// so every larger step is counted as missed releases. A time or sequence
+// number going backwards is a restart of the program, no period is taken
+// across it.
+//
+// The log is mapped, cut into one piece per thread at line boundaries and
+// parsed without copying. Each thread keeps its own statistics; they are
+// merged in file order afterwards, adding the period between the last
+// release of one piece and the first of the next.
+//
+// Usage: logstat [-t threads] log...
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/sysinfo.h>
+
+#define MAX_SVC (16)            // service 0 is the sequencer
+#define MAX_CORES (64)
+#define MAX_THREADS (64)
+
+// Log-linear period histogram in microseconds, 128 sub-buckets per power of
+// two keep percentiles within 1%
+#define HIST_SUB_BITS (7)
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS (HIST_SUB + 40 * HIST_SUB)
+
+// Sequence steps counted one by one, larger steps are summed
+#define MAX_STEP (256)
+
+typedef struct
+{
+    unsigned long long count;                   // releases
+    double first_t, last_t;                     // seconds
+    unsigned long long first_seq, last_seq;
+    unsigned long long restarts;
+
+    unsigned long long periods;
+    double sum, sumsq;                          // microseconds
+    unsigned long long min_us, max_us;
+    unsigned long long hist[HIST_BUCKETS];
+
+    unsigned long long steps[MAX_STEP];         // sequence number increments
+    unsigned long long big_steps, big_step_sum;
+
+    unsigned long long cores[MAX_CORES];
+    unsigned long long no_core;
+} svc_acc_t;
+
+typedef struct
+{
+    const char *begin, *end;
+    unsigned long long lines, matched;
+    svc_acc_t svc[MAX_SVC];
+} chunk_t;
+
+static const char *svc_names[MAX_SVC] = { "Sequencer" };
+
+static int bucket_of(unsigned long long us) {
+    int msb;
+
+    if (us < HIST_SUB)
+        return (int)us;
+    msb = 63 - __builtin_clzll(us);
+    if (msb - HIST_SUB_BITS >= HIST_BUCKETS / HIST_SUB - 1)
+        return HIST_BUCKETS - 1;
+    return HIST_SUB + (msb - HIST_SUB_BITS) * HIST_SUB + (int)((us >> (msb - HIST_SUB_BITS)) - HIST_SUB);
+}
+
+// Middle of a bucket
+static double bucket_mid(int b) {
+    int shift;
+
+    if (b < HIST_SUB)
+        return b;
+    shift = (b - HIST_SUB) / HIST_SUB;
+    return ((double)(HIST_SUB + (b - HIST_SUB) % HIST_SUB) + 0.5) * (1ULL << shift);
+}
+
+// Fold one inter-release gap into the statistics
+static void add_period(svc_acc_t *acc, double dt, long long dseq) {
+    unsigned long long us;
+
+    if (dt < 0 || dseq <= 0) {
+        acc->restarts++;
+        return;
+    }
+
+    us = (unsigned long long)llround(dt * 1000000.0);
+    if (acc->periods == 0 || us < acc->min_us)
+        acc->min_us = us;
+    if (us > acc->max_us)
+        acc->max_us = us;
+    acc->periods++;
+    acc->sum += us;
+    acc->sumsq += (double)us * us;
+    acc->hist[bucket_of(us)]++;
+
+    if (dseq < MAX_STEP) {
+        acc->steps[dseq]++;
+    } else {
+        acc->big_steps++;
+        acc->big_step_sum += dseq;
+    }
+}
+
+static void observe(svc_acc_t *acc, double t, unsigned long long seq, int core) {
+    if (acc->count == 0) {
+        acc->first_t = t;
+        acc->first_seq = seq;
+    } else {
+        add_period(acc, t - acc->last_t, (long long)(seq - acc->last_seq));
+    }
+    acc->last_t = t;
+    acc->last_seq = seq;
+    acc->count++;
+
+    if (core >= 0 && core < MAX_CORES)
+        acc->cores[core]++;
+    else
+        acc->no_core++;
+}
+
+// Append the statistics of the next piece of the file to acc
+static void merge(svc_acc_t *acc, const svc_acc_t *next) {
+    int i;
+
+    if (next->count == 0)
+        return;
+    if (acc->count == 0) {
+        *acc = *next;
+        return;
+    }
+
+    add_period(acc, next->first_t - acc->last_t, (long long)(next->first_seq - acc->last_seq));
+
+    if (next->periods > 0) {
+        if (acc->periods == 0 || next->min_us < acc->min_us)
+            acc->min_us = next->min_us;
+        if (next->max_us > acc->max_us)
+            acc->max_us = next->max_us;
+    }
+    acc->periods += next->periods;
+    acc->sum += next->sum;
+    acc->sumsq += next->sumsq;
+    for (i = 0; i < HIST_BUCKETS; i++)
+        acc->hist[i] += next->hist[i];
+    for (i = 0; i < MAX_STEP; i++)
+        acc->steps[i] += next->steps[i];
+    acc->big_steps += next->big_steps;
+    acc->big_step_sum += next->big_step_sum;
+    for (i = 0; i < MAX_CORES; i++)
+        acc->cores[i] += next->cores[i];
+    acc->no_core += next->no_core;
+    acc->restarts += next->restarts;
+
+    acc->count += next->count;
+    acc->last_t = next->last_t;
+    acc->last_seq = next->last_seq;
+}
+
+// Number parsers bounded by the end of the line, the mapping is not terminated
+static int parse_uint(const char **pp, const char *end, unsigned long long *value) {
+    const char *p = *pp;
+    unsigned long long v = 0;
+
+    if (p >= end || *p < '0' || *p > '9')
+        return -1;
+    while (p < end && *p >= '0' && *p <= '9')
+        v = v * 10 + (*p++ - '0');
+
+    *value = v;
+    *pp = p;
+    return 0;
+}
+
+static int parse_double(const char **pp, const char *end, double *value) {
+    unsigned long long whole;
+    double frac = 0, scale = 0.1;
+    const char *p;
+
+    if (parse_uint(pp, end, &whole))
+        return -1;
+    p = *pp;
+    if (p < end && *p == '.')
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, scale *= 0.1)
+            frac += (*p - '0') * scale;
+
+    *value = whole + frac;
+    *pp = p;
+    return 0;
+}
+
+static int expect(const char **pp, const char *end, const char *text) {
+    size_t len = strlen(text);
+
+    if ((size_t)(end - *pp) < len || memcmp(*pp, text, len) != 0)
+        return -1;
+    *pp += len;
+    return 0;
+}
+
+// "Sequencer cycle N @ sec=S, msec=M"
+static int parse_cycle(chunk_t *chunk, const char *p, const char *end) {
+    unsigned long long seq, sec, msec;
+
+    if (parse_uint(&p, end, &seq) || expect(&p, end, " @ sec=") || parse_uint(&p, end, &sec) ||
+        expect(&p, end, ", msec=") || parse_uint(&p, end, &msec))
+        return -1;
+
+    observe(&chunk->svc[0], sec + msec / 1000.0, seq, -1);
+    return 0;
+}
+
+// "Thread N start K @ T on core C"
+static int parse_thread(chunk_t *chunk, const char *p, const char *end) {
+    unsigned long long svc, seq, core;
+    double t;
+
+    if (parse_uint(&p, end, &svc) || expect(&p, end, " start ") || parse_uint(&p, end, &seq) ||
+        expect(&p, end, " @ ") || parse_double(&p, end, &t) || expect(&p, end, " on core ") ||
+        parse_uint(&p, end, &core) || svc == 0 || svc >= MAX_SVC)
+        return -1;
+
+    observe(&chunk->svc[svc], t, seq, (int)core);
+    return 0;
+}
+
+// "SN F Hz on core C for release R @ sec=T", hz points at " Hz on core "
+static int parse_hz(chunk_t *chunk, const char *line, const char *hz, const char *end) {
+    const char *p = hz, *tag;
+    unsigned long long svc, seq, core;
+    double t;
+
+    // Back over the rate and the space to the service tag
+    while (p > line && p[-1] >= '0' && p[-1] <= '9')
+        p--;
+    if (p == hz || p <= line || *--p != ' ')
+        return -1;
+    while (p > line && p[-1] >= '0' && p[-1] <= '9')
+        p--;
+    if (p <= line || p[-1] != 'S')
+        return -1;
+    tag = p;
+    if (parse_uint(&tag, end, &svc) || svc == 0 || svc >= MAX_SVC)
+        return -1;
+
+    // seqgen2 prints "forrelease" for S3, so skip up to the number
+    p = hz + strlen(" Hz on core ");
+    if (parse_uint(&p, end, &core))
+        return -1;
+    p = memmem(p, end - p, "release ", 8);
+    if (p == NULL)
+        return -1;
+    p += 8;
+    if (parse_uint(&p, end, &seq) || expect(&p, end, " @ sec=") || parse_double(&p, end, &t))
+        return -1;
+
+    observe(&chunk->svc[svc], t, seq, (int)core);
+    return 0;
+}
+
+static void parse_line(chunk_t *chunk, const char *line, const char *end) {
+    const char *at, *p;
+    int rc = -1;
+
+    // All three formats have " @ " after the part that tells them apart
+    at = memmem(line, end - line, " @ ", 3);
+    if (at == NULL)
+        return;
+
+    if ((p = memmem(line, at - line, "Sequencer cycle ", 16)) != NULL)
+        rc = parse_cycle(chunk, p + 16, end);
+    else if ((p = memmem(line, at - line, "Thread ", 7)) != NULL)
+        rc = parse_thread(chunk, p + 7, end);
+    else if ((p = memmem(line, at - line, " Hz on core ", 12)) != NULL)
+        rc = parse_hz(chunk, line, p, end);
+
+    if (rc == 0)
+        chunk->matched++;
+}
+
+static void *parse_chunk(void *arg) {
+    chunk_t *chunk = (chunk_t *)arg;
+    const char *line = chunk->begin, *nl;
+
+    while (line < chunk->end) {
+        nl = memchr(line, '\n', chunk->end - line);
+        if (nl == NULL)
+            nl = chunk->end;
+        parse_line(chunk, line, nl);
+        chunk->lines++;
+        line = nl + 1;
+    }
+
+    return NULL;
+}
+
+// Percentile in microseconds, the middle of its bucket kept within min and max
+static double percentile(const svc_acc_t *acc, double pct) {
+    unsigned long long target = (unsigned long long)ceil(acc->periods * pct / 100.0), seen = 0;
+    int i;
+
+    for (i = 0; i < HIST_BUCKETS; i++) {
+        seen += acc->hist[i];
+        if (seen >= target && seen > 0)
+            return fmin(fmax(bucket_mid(i), acc->min_us), acc->max_us);
+    }
+    return acc->max_us;
+}
+
+static unsigned long long missed_releases(const svc_acc_t *acc) {
+    unsigned long long step = 0, missed = 0;
+    int i;
+
+    for (i = 1; i < MAX_STEP && step == 0; i++)
+        if (acc->steps[i])
+            step = i;
+    if (step == 0)
+        step = acc->big_steps ? acc->big_step_sum / acc->big_steps : 1;
+
+    for (i = step + 1; i < MAX_STEP; i++)
+        missed += acc->steps[i] * (i / step - 1);
+    if (acc->big_step_sum / step > acc->big_steps)
+        missed += acc->big_step_sum / step - acc->big_steps;
+
+    return missed;
+}
+
+static void report(const char *path, const svc_acc_t *svc) {
+    char name[16];
+    double mean, stddev;
+    int s, c;
+
+    printf("\n%s\n", path);
+    printf("%-10s %9s %7s %5s %10s %9s %9s %9s %9s %9s %9s  %s\n", "Service", "releases", "missed", "rst",
+           "mean ms", "stddev", "min", "p50", "p99", "max", "jitter", "cores");
+
+    for (s = 0; s < MAX_SVC; s++) {
+        const svc_acc_t *acc = &svc[s];
+
+        if (acc->count == 0)
+            continue;
+        if (svc_names[s] != NULL)
+            snprintf(name, sizeof(name), "%s", svc_names[s]);
+        else
+            snprintf(name, sizeof(name), "S%d", s);
+
+        mean = acc->periods ? acc->sum / acc->periods : 0;
+        stddev = acc->periods ? sqrt(fmax(acc->sumsq / acc->periods - mean * mean, 0)) : 0;
+
+        printf("%-10s %9llu %7llu %5llu %10.3f %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f ", name, acc->count,
+               missed_releases(acc), acc->restarts, mean / 1000.0, stddev / 1000.0, acc->min_us / 1000.0,
+               percentile(acc, 50) / 1000.0, percentile(acc, 99) / 1000.0, acc->max_us / 1000.0,
+               (acc->max_us - acc->min_us) / 1000.0);
+
+        // Core residency as a share of the releases that named a core
+        if (acc->no_core == acc->count)
+            printf(" -");
+        for (c = 0; c < MAX_CORES; c++)
+            if (acc->cores[c])
+                printf(" %d:%.1f%%", c, 100.0 * acc->cores[c] / (acc->count - acc->no_core));
+        printf("\n");
+    }
+}
+
+static int analyze(const char *path, int nthreads) {
+    static svc_acc_t total[MAX_SVC];
+    chunk_t *chunks;
+    pthread_t threads[MAX_THREADS];
+    unsigned long long lines = 0, matched = 0;
+    struct timespec t0, t1;
+    struct stat st;
+    const char *data, *cut;
+    double secs;
+    int fd, i, s;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(path);
+        return -1;
+    }
+    if (st.st_size == 0) {
+        printf("%s is empty\n", path);
+        close(fd);
+        return -1;
+    }
+
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+    madvise((void *)data, st.st_size, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    // One piece per thread, each ending just after a newline
+    if ((off_t)nthreads > st.st_size)
+        nthreads = 1;
+    chunks = calloc(nthreads, sizeof(chunk_t));
+    if (chunks == NULL) {
+        printf("Failed to allocate %d chunks\n", nthreads);
+        munmap((void *)data, st.st_size);
+        return -1;
+    }
+    cut = data;
+    for (i = 0; i < nthreads; i++) {
+        chunks[i].begin = cut;
+        if (i == nthreads - 1) {
+            cut = data + st.st_size;
+        } else {
+            cut = data + (st.st_size * (i + 1)) / nthreads;
+            if (cut < chunks[i].begin)
+                cut = chunks[i].begin;
+            cut = memchr(cut, '\n', data + st.st_size - cut);
+            cut = (cut == NULL) ? data + st.st_size : cut + 1;
+        }
+        chunks[i].end = cut;
+    }
+
+    for (i = 0; i < nthreads; i++)
+        if (pthread_create(&threads[i], NULL, parse_chunk, &chunks[i]) != 0) {
+            perror("pthread_create");
+            parse_chunk(&chunks[i]);
+            threads[i] = 0;
+        }
+
+    memset(total, 0, sizeof(total));
+    for (i = 0; i < nthreads; i++) {
+        if (threads[i])
+            pthread_join(threads[i], NULL);
+        for (s = 0; s < MAX_SVC; s++)
+            merge(&total[s], &chunks[i].svc[s]);
+        lines += chunks[i].lines;
+        matched += chunks[i].matched;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    report(path, total);
+    printf("%llu lines, %llu releases, %.1f MB in %.3f s (%.0f MB/s, %d threads)\n", lines, matched,
+           st.st_size / 1e6, secs, secs > 0 ? st.st_size / 1e6 / secs : 0.0, nthreads);
+
+    free(chunks);
+    munmap((void *)data, st.st_size);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int opt, nthreads = get_nprocs(), rc = 0;
+
+    while ((opt = getopt(argc, argv, "t:")) != -1) {
+        switch (opt) {
+        case 't':
+            nthreads = atoi(optarg);
+            break;
+        default:
+            printf("Usage: %s [-t threads] log...\n", argv[0]);
+            return -1;
+        }
+    }
+    if (optind >= argc) {
+        printf("Usage: %s [-t threads] log...\n", argv[0]);
+        return -1;
+    }
+    if (nthreads < 1)
+        nthreads = 1;
+    if (nthreads > MAX_THREADS)
+        nthreads = MAX_THREADS;
+
+    for (; optind < argc; optind++)
+        if (analyze(argv[optind], nthreads) != 0)
+            rc = -1;
+
+    return rc;
+}
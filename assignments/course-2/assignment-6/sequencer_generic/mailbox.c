@@ -0,0 +1,93 @@
+/**
+ * File: mailbox.c
+ * Author: Brad Waggle
+ * Description: Seqlock mailboxes for latest-value results shared between
+ *              services.
+ * Date: October 18, 2026
+ */
+
+// For results where only the newest value matters, e.g. the frame time-stamp
+// from Service_2 and the difference result from Service_3 read by the save
+// service. A mutex would make the writer and every reader take turns across
+// priorities. Here the writer never waits: it makes the sequence number odd,
+// stores the value and makes it even again. A reader copies the value and
+// starts over only if the sequence number was odd or changed meanwhile,
+// which happens only when the copy overlapped a write.
+//
+// The value is held in relaxed atomic words so that a torn copy is never a
+// data race, and the fences give the usual seqlock ordering.
+//
+// A reader can still be starved by a writer that writes back to back, which
+// the periodic services here never do.
+
+#include <stdio.h>
+#include <string.h>
+#include "mailbox.h"
+
+int mailbox_init(mailbox_t *mb, const char *name, size_t size) {
+    unsigned int i;
+
+    if (size > MAILBOX_MAX_SIZE) {
+        printf("Mailbox %s: %zu bytes is over the %d byte limit\n", name, size, MAILBOX_MAX_SIZE);
+        return -1;
+    }
+
+    memset(mb, 0, sizeof(*mb));
+    mb->name = name;
+    mb->size = size;
+    atomic_init(&mb->seq, 0);
+    for (i = 0; i < MAILBOX_WORDS; i++)
+        atomic_init(&mb->words[i], 0);
+    atomic_init(&mb->retries, 0);
+
+    return 0;
+}
+
+// Only one thread may write a given mailbox
+void mailbox_write(mailbox_t *mb, const void *value) {
+    unsigned long buf[MAILBOX_WORDS];
+    unsigned int seq = atomic_load_explicit(&mb->seq, memory_order_relaxed);
+    unsigned int i, nwords = (mb->size + sizeof(unsigned long) - 1) / sizeof(unsigned long);
+
+    memcpy(buf, value, mb->size);
+
+    atomic_store_explicit(&mb->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    for (i = 0; i < nwords; i++)
+        atomic_store_explicit(&mb->words[i], buf[i], memory_order_relaxed);
+
+    atomic_store_explicit(&mb->seq, seq + 2, memory_order_release);
+    mb->writes++;
+}
+
+// Copy out the latest value. Returns the number of writes it reflects, 0 if
+// the mailbox was never written.
+unsigned int mailbox_read(mailbox_t *mb, void *value) {
+    unsigned long buf[MAILBOX_WORDS];
+    unsigned int start, end, i;
+    unsigned int nwords = (mb->size + sizeof(unsigned long) - 1) / sizeof(unsigned long);
+
+    for (;;) {
+        start = atomic_load_explicit(&mb->seq, memory_order_acquire);
+        if ((start & 1) == 0) {
+            for (i = 0; i < nwords; i++)
+                buf[i] = atomic_load_explicit(&mb->words[i], memory_order_relaxed);
+
+            atomic_thread_fence(memory_order_acquire);
+            end = atomic_load_explicit(&mb->seq, memory_order_relaxed);
+            if (start == end)
+                break;
+        }
+        atomic_fetch_add_explicit(&mb->retries, 1, memory_order_relaxed);
+    }
+
+    memcpy(value, buf, mb->size);
+
+    return start / 2;
+}
+
+void mailbox_report(mailbox_t *mb) {
+    printf("Mailbox %s: %zu bytes, writes=%llu torn read retries=%llu\n",
+           mb->name, mb->size, mb->writes, atomic_load(&mb->retries));
+}
@@ -0,0 +1,30 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+// Largest value a mailbox can hold
+#define MAILBOX_MAX_SIZE (128)
+#define MAILBOX_WORDS (MAILBOX_MAX_SIZE / sizeof(unsigned long))
+
+// Latest-value mailbox, one writer and any number of readers
+typedef struct
+{
+    const char *name;
+    size_t size;                            // bytes in the value
+    atomic_uint seq;                        // odd while the writer is updating the value
+    atomic_ulong words[MAILBOX_WORDS];      // the value, copied word by word
+
+    // Torn reads on their own cache line, away from seq and the value. Reads
+    // are not counted, a shared counter would make the readers contend.
+    _Alignas(64) atomic_ullong retries;
+    unsigned long long writes;              // only touched by the writer
+} mailbox_t;
+
+int mailbox_init(mailbox_t *mb, const char *name, size_t size);
+void mailbox_write(mailbox_t *mb, const void *value);
+unsigned int mailbox_read(mailbox_t *mb, void *value);
+void mailbox_report(mailbox_t *mb);
+
+#endif
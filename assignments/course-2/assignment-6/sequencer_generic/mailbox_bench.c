@@ -0,0 +1,215 @@
+/**
+ * File: mailbox_bench.c
+ * Author: Brad Waggle
+ * Description: Read and write cost of a seqlock mailbox against a mutex
+ *              protected value, with readers spinning on other cores.
+ * Date: October 18, 2026
+ */
+
+// One writer is pinned to the first core and updates a 64 byte value as
+// fast as it can. Each reader is pinned to the next core round robin and
+// reads as fast as it can. Both variants run for the same time and report
+// mean cost per operation, the worst single write (a reader holding the
+// mutex shows up here) and, for the mailbox, how often a read was torn.
+//
+// Threads run SCHED_OTHER so that readers sharing a core with the writer
+// on a small machine cannot starve it.
+//
+// Usage: mailbox_bench [readers] [seconds]
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/sysinfo.h>
+#include "mailbox.h"
+#include "rt_time.h"
+
+#define DEFAULT_READERS (3)
+#define DEFAULT_SECONDS (2)
+#define MAX_READERS (64)
+
+// Value shared in both variants, big enough that a torn read is possible
+typedef struct
+{
+    unsigned long long seq;
+    unsigned long long payload[7];
+} bench_value_t;
+
+static int num_readers;
+static int num_seconds;
+static atomic_int running;
+
+static mailbox_t mailbox;
+static pthread_mutex_t value_lock = PTHREAD_MUTEX_INITIALIZER;
+static bench_value_t locked_value;
+
+// Per thread results, padded so the threads do not share lines
+typedef struct
+{
+    unsigned long long ops;
+    unsigned long long worst_ns;
+    unsigned long long bad;         // values whose words did not agree
+    char pad[40];
+} bench_result_t;
+
+static bench_result_t writer_result;
+static bench_result_t reader_results[MAX_READERS];
+
+static void pin(int cpu) {
+    cpu_set_t cpuset;
+
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu % get_nprocs(), &cpuset);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+}
+
+static void fill(bench_value_t *v, unsigned long long seq) {
+    int i;
+
+    v->seq = seq;
+    for (i = 0; i < 7; i++)
+        v->payload[i] = seq;
+}
+
+// A torn value would mix words from two writes
+static int consistent(const bench_value_t *v) {
+    int i;
+
+    for (i = 0; i < 7; i++)
+        if (v->payload[i] != v->seq)
+            return 0;
+    return 1;
+}
+
+static void *mailbox_writer(void *arg) {
+    bench_value_t v;
+    unsigned long long seq = 0, start, elapsed;
+
+    pin(0);
+    while (atomic_load_explicit(&running, memory_order_relaxed)) {
+        fill(&v, ++seq);
+        start = rt_time_mono();
+        mailbox_write(&mailbox, &v);
+        elapsed = rt_time_mono() - start;
+        if (elapsed > writer_result.worst_ns)
+            writer_result.worst_ns = elapsed;
+    }
+    writer_result.ops = seq;
+
+    return NULL;
+}
+
+static void *mailbox_reader(void *arg) {
+    bench_result_t *res = &reader_results[(long)arg];
+    bench_value_t v;
+
+    pin((int)(long)arg + 1);
+    while (atomic_load_explicit(&running, memory_order_relaxed)) {
+        mailbox_read(&mailbox, &v);
+        if (!consistent(&v))
+            res->bad++;
+        res->ops++;
+    }
+
+    return NULL;
+}
+
+static void *mutex_writer(void *arg) {
+    bench_value_t v;
+    unsigned long long seq = 0, start, elapsed;
+
+    pin(0);
+    while (atomic_load_explicit(&running, memory_order_relaxed)) {
+        fill(&v, ++seq);
+        start = rt_time_mono();
+        pthread_mutex_lock(&value_lock);
+        locked_value = v;
+        pthread_mutex_unlock(&value_lock);
+        elapsed = rt_time_mono() - start;
+        if (elapsed > writer_result.worst_ns)
+            writer_result.worst_ns = elapsed;
+    }
+    writer_result.ops = seq;
+
+    return NULL;
+}
+
+static void *mutex_reader(void *arg) {
+    bench_result_t *res = &reader_results[(long)arg];
+    bench_value_t v;
+
+    pin((int)(long)arg + 1);
+    while (atomic_load_explicit(&running, memory_order_relaxed)) {
+        pthread_mutex_lock(&value_lock);
+        v = locked_value;
+        pthread_mutex_unlock(&value_lock);
+        if (!consistent(&v))
+            res->bad++;
+        res->ops++;
+    }
+
+    return NULL;
+}
+
+static void run(const char *name, void *(*writer)(void *), void *(*reader)(void *)) {
+    pthread_t writer_thread, reader_threads[MAX_READERS];
+    unsigned long long reads = 0, bad = 0;
+    double write_ns, read_ns;
+    long i;
+
+    memset(&writer_result, 0, sizeof(writer_result));
+    memset(reader_results, 0, sizeof(reader_results));
+    atomic_store(&running, 1);
+
+    pthread_create(&writer_thread, NULL, writer, NULL);
+    for (i = 0; i < num_readers; i++)
+        pthread_create(&reader_threads[i], NULL, reader, (void *)i);
+
+    sleep(num_seconds);
+    atomic_store(&running, 0);
+
+    pthread_join(writer_thread, NULL);
+    for (i = 0; i < num_readers; i++) {
+        pthread_join(reader_threads[i], NULL);
+        reads += reader_results[i].ops;
+        bad += reader_results[i].bad;
+    }
+
+    // Per operation cost as seen by one thread, threads run in parallel
+    write_ns = (num_seconds * 1e9) / (writer_result.ops ? writer_result.ops : 1);
+    read_ns = (num_seconds * 1e9 * num_readers) / (reads ? reads : 1);
+
+    printf("%-8s %d readers: write %.1f ns (worst %.1f us), read %.1f ns, %llu writes, %llu reads, %llu inconsistent",
+           name, num_readers, write_ns, writer_result.worst_ns / 1000.0, read_ns,
+           writer_result.ops, reads, bad);
+    if (writer == mailbox_writer)
+        printf(", %.2f retries per 1000 reads", reads ? (1000.0 * atomic_load(&mailbox.retries)) / reads : 0.0);
+    printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    num_readers = (argc > 1) ? atoi(argv[1]) : DEFAULT_READERS;
+    num_seconds = (argc > 2) ? atoi(argv[2]) : DEFAULT_SECONDS;
+
+    if (num_readers < 1 || num_readers > MAX_READERS || num_seconds < 1) {
+        printf("readers must be 1..%d and seconds at least 1\n", MAX_READERS);
+        return -1;
+    }
+
+    printf("%d cores, writer on core 0, readers from core 1 round robin\n", get_nprocs());
+
+    if (mailbox_init(&mailbox, "bench", sizeof(bench_value_t)))
+        return -1;
+
+    run("seqlock", mailbox_writer, mailbox_reader);
+    run("mutex", mutex_writer, mutex_reader);
+
+    return 0;
+}
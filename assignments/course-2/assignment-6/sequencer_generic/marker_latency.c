@@ -0,0 +1,463 @@
+/**
+ * File: marker_latency.c
+ * Author: Brad Waggle
+ * Description: Attributes each release's latency to what ran on the
+ *              service's core, from an ftrace text trace with markers.
+ * Date: October 18, 2026
+ */
+
+// Reads the text form of an ftrace capture taken while seqgenex0 was built
+// with -DFTRACE_MARKERS, either /sys/kernel/tracing/trace or the output of
+// trace-cmd report, with sched_switch and optionally irq_handler_entry/exit
+// and softirq_entry/exit enabled. For example:
+//
+//   trace-cmd record -e sched_switch -e irq -e softirq ./seqgenex0
+//   trace-cmd report | ./marker_latency
+//
+// Between the sequencer's "I|pid|SN release K" marker and the service's
+// "B|pid|SN K" marker, every task, interrupt and softirq that held a core is
+// charged the time it held it. When the service starts, the charges on the
+// core it started on are the release's latency broken down by culprit (the
+// service's own thread is left out). Per service it prints where the time
+// went over all releases and the worst releases in full.
+//
+// The input is streamed; only the open release of each service and the
+// worst few are kept.
+//
+// Usage: marker_latency [-w worst] [trace.txt]
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_SVC (16)
+#define MAX_CPUS (256)
+#define MAX_NEST (4)            // interrupt levels stacked on a task
+#define MAX_SHARES (64)         // culprits kept per release, the rest go to "other"
+#define MAX_TOTALS (256)        // culprits kept per service
+#define MAX_WORST (32)
+#define NAME_LEN (48)
+
+// Time one task or interrupt held one core during a release's latency
+typedef struct
+{
+    char name[NAME_LEN];
+    int pid;                    // -1 for interrupts
+    int cpu;
+    unsigned long long ns;
+} share_t;
+
+typedef struct
+{
+    unsigned long long seq;
+    unsigned long long release_ns;
+    unsigned long long latency_ns;
+    int cpu;
+    int nshares;
+    share_t shares[MAX_SHARES];
+} release_t;
+
+typedef struct
+{
+    char name[NAME_LEN];
+    unsigned long long ns;
+    unsigned long long releases;
+} total_t;
+
+typedef struct
+{
+    int open;                   // released and not started yet
+    release_t current;
+    unsigned long long releases, started, overruns, misses;
+    unsigned long long unmatched;       // starts of a release other than the open one
+    unsigned long long latency_sum_ns, latency_max_ns;
+    release_t worst[MAX_WORST];
+    int nworst;
+    total_t totals[MAX_TOTALS];
+    int ntotals;
+} svc_t;
+
+// What holds each core, from sched_switch and the interrupt events
+typedef struct
+{
+    int known;                  // a sched_switch has been seen
+    char task[NAME_LEN];
+    int pid;
+    char nest[MAX_NEST][NAME_LEN];
+    int depth;
+    unsigned long long since_ns;
+} cpu_t;
+
+static svc_t svcs[MAX_SVC];
+static cpu_t cpus[MAX_CPUS];
+static int max_worst = 10;
+
+static unsigned long long parse_ts(const char *p, const char **end) {
+    unsigned long long sec = 0, frac = 0, scale = 1000000000ULL;
+
+    while (*p >= '0' && *p <= '9')
+        sec = sec * 10 + (*p++ - '0');
+    if (*p == '.')
+        for (p++; *p >= '0' && *p <= '9'; p++)
+            if (scale > 1) {
+                scale /= 10;
+                frac += (*p - '0') * scale;
+            }
+    *end = p;
+    return sec * 1000000000ULL + frac;
+}
+
+static void add_share(release_t *rel, int cpu, const char *name, int pid, unsigned long long ns) {
+    int i;
+
+    for (i = 0; i < rel->nshares; i++)
+        if (rel->shares[i].cpu == cpu && rel->shares[i].pid == pid && strcmp(rel->shares[i].name, name) == 0) {
+            rel->shares[i].ns += ns;
+            return;
+        }
+
+    if (rel->nshares == MAX_SHARES) {
+        name = "other";
+        pid = -2;
+        i = MAX_SHARES - 1;
+        if (rel->shares[i].pid != pid) {
+            snprintf(rel->shares[i].name, NAME_LEN, "%s", name);
+            rel->shares[i].pid = pid;
+        }
+        rel->shares[i].ns += ns;
+        return;
+    }
+
+    snprintf(rel->shares[rel->nshares].name, NAME_LEN, "%s", name);
+    rel->shares[rel->nshares].pid = pid;
+    rel->shares[rel->nshares].cpu = cpu;
+    rel->shares[rel->nshares].ns = ns;
+    rel->nshares++;
+}
+
+// Charge whoever held the core since the last event to every open release
+static void account(int cpu, unsigned long long ts) {
+    cpu_t *c = &cpus[cpu];
+    const char *name;
+    unsigned long long from;
+    int s, pid;
+
+    if (c->known && ts > c->since_ns) {
+        name = c->depth ? c->nest[c->depth - 1] : c->task;
+        pid = c->depth ? -1 : c->pid;
+        for (s = 0; s < MAX_SVC; s++) {
+            if (!svcs[s].open)
+                continue;
+            from = (c->since_ns > svcs[s].current.release_ns) ? c->since_ns : svcs[s].current.release_ns;
+            if (ts > from)
+                add_share(&svcs[s].current, cpu, name, pid, ts - from);
+        }
+    }
+    c->since_ns = ts;
+}
+
+static void add_total(svc_t *svc, const share_t *share) {
+    int i;
+
+    for (i = 0; i < svc->ntotals; i++)
+        if (strcmp(svc->totals[i].name, share->name) == 0)
+            break;
+    if (i == svc->ntotals) {
+        if (svc->ntotals == MAX_TOTALS)
+            i = MAX_TOTALS - 1;
+        else
+            svc->ntotals++;
+        snprintf(svc->totals[i].name, NAME_LEN, "%s", (i == MAX_TOTALS - 1) ? "other" : share->name);
+    }
+    svc->totals[i].ns += share->ns;
+    svc->totals[i].releases++;
+}
+
+static int by_ns_desc(const void *a, const void *b) {
+    unsigned long long x = ((const share_t *)a)->ns, y = ((const share_t *)b)->ns;
+
+    return (x < y) - (x > y);
+}
+
+static int totals_desc(const void *a, const void *b) {
+    unsigned long long x = ((const total_t *)a)->ns, y = ((const total_t *)b)->ns;
+
+    return (x < y) - (x > y);
+}
+
+// The service started on cpu: keep the shares on that core, without its own thread
+static void finish(svc_t *svc, int cpu, int pid, unsigned long long ts) {
+    release_t *rel = &svc->current;
+    int i, kept = 0, slot;
+
+    account(cpu, ts);
+    rel->latency_ns = ts - rel->release_ns;
+    rel->cpu = cpu;
+
+    for (i = 0; i < rel->nshares; i++)
+        if (rel->shares[i].cpu == cpu && rel->shares[i].pid != pid)
+            rel->shares[kept++] = rel->shares[i];
+    rel->nshares = kept;
+    qsort(rel->shares, rel->nshares, sizeof(share_t), by_ns_desc);
+
+    for (i = 0; i < rel->nshares; i++)
+        add_total(svc, &rel->shares[i]);
+
+    svc->started++;
+    svc->latency_sum_ns += rel->latency_ns;
+    if (rel->latency_ns > svc->latency_max_ns)
+        svc->latency_max_ns = rel->latency_ns;
+
+    // Keep the worst releases, sorted by latency
+    if (svc->nworst < max_worst)
+        slot = svc->nworst++;
+    else if (rel->latency_ns > svc->worst[svc->nworst - 1].latency_ns)
+        slot = svc->nworst - 1;
+    else
+        slot = -1;
+    if (slot >= 0) {
+        while (slot > 0 && svc->worst[slot - 1].latency_ns < rel->latency_ns) {
+            svc->worst[slot] = svc->worst[slot - 1];
+            slot--;
+        }
+        svc->worst[slot] = *rel;
+    }
+
+    svc->open = 0;
+}
+
+// "I|pid|SN release K", "I|pid|SN miss K", "B|pid|SN K" or "E|pid"
+static void marker(const char *text, int cpu, int pid, unsigned long long ts) {
+    unsigned long long seq;
+    char kind = text[0];
+    int s;
+
+    if ((kind != 'I' && kind != 'B') || text[1] != '|')
+        return;
+    text = strchr(text + 2, '|');
+    if (text == NULL || text[1] != 'S')
+        return;
+    text += 2;
+
+    if (kind == 'B') {
+        if (sscanf(text, "%d %llu", &s, &seq) != 2 || s < 0 || s >= MAX_SVC)
+            return;
+        // A start pairs only with the release of the same number
+        if (svcs[s].open && svcs[s].current.seq == seq)
+            finish(&svcs[s], cpu, pid, ts);
+        else
+            svcs[s].unmatched++;
+        return;
+    }
+
+    if (sscanf(text, "%d release %llu", &s, &seq) == 2 && s >= 0 && s < MAX_SVC) {
+        if (svcs[s].open)
+            svcs[s].overruns++;         // the previous release never started
+        memset(&svcs[s].current, 0, sizeof(release_t));
+        svcs[s].current.seq = seq;
+        svcs[s].current.release_ns = ts;
+        svcs[s].open = 1;
+        svcs[s].releases++;
+    } else if (sscanf(text, "%d miss %llu", &s, &seq) == 2 && s >= 0 && s < MAX_SVC) {
+        svcs[s].misses++;
+    }
+}
+
+// Name of the task switched in, from either the kernel or the trace-cmd layout
+static void switched_in(cpu_t *c, const char *payload) {
+    const char *p;
+    char comm[NAME_LEN] = "?";
+    int pid = -1;
+
+    if ((p = strstr(payload, "next_comm=")) != NULL) {
+        sscanf(p, "next_comm=%31s", comm);
+        if ((p = strstr(p, "next_pid=")) != NULL)
+            pid = atoi(p + 9);
+    } else if ((p = strstr(payload, "==> ")) != NULL) {
+        // "comm:pid [prio]", the comm may itself hold a colon
+        const char *end = strstr(p + 4, " [");
+        const char *colon = NULL, *q;
+
+        for (q = p + 4; end != NULL && q < end; q++)
+            if (*q == ':')
+                colon = q;
+        if (colon != NULL) {
+            snprintf(comm, sizeof(comm), "%.*s", (int)(colon - (p + 4)), p + 4);
+            pid = atoi(colon + 1);
+        }
+    }
+
+    c->pid = pid;
+    if (pid == 0)
+        snprintf(c->task, NAME_LEN, "<idle>");
+    else
+        snprintf(c->task, NAME_LEN, "%.31s-%d", comm, pid);
+    c->depth = 0;
+    c->known = 1;
+}
+
+static void push(cpu_t *c, const char *name) {
+    if (c->depth < MAX_NEST)
+        snprintf(c->nest[c->depth], NAME_LEN, "%s", name);
+    c->depth++;
+}
+
+static void pop(cpu_t *c) {
+    if (c->depth > 0)
+        c->depth--;
+}
+
+// "  comm-pid  [cpu] flags  12345.678901: event: payload"
+static void parse_line(const char *line) {
+    const char *p, *bracket, *dash, *event, *payload;
+    unsigned long long ts;
+    char name[NAME_LEN], irq[NAME_LEN];
+    int cpu, pid, n;
+    cpu_t *c;
+
+    bracket = strstr(line, " [");
+    if (bracket == NULL || line[0] == '#')
+        return;
+    cpu = atoi(bracket + 2);
+    if (cpu < 0 || cpu >= MAX_CPUS)
+        return;
+    for (dash = bracket; dash > line && *dash != '-'; dash--)
+        ;
+    pid = (*dash == '-') ? atoi(dash + 1) : -1;
+
+    // Skip the flags column if there is one, then the time stamp
+    p = strchr(bracket, ']');
+    if (p == NULL)
+        return;
+    for (;;) {
+        while (*++p == ' ')
+            ;
+        if (*p >= '0' && *p <= '9') {
+            ts = parse_ts(p, &p);
+            if (*p == ':')
+                break;
+        }
+        p = strchr(p, ' ');
+        if (p == NULL)
+            return;
+        p--;
+    }
+
+    event = p + 2;
+    payload = strchr(event, ':');
+    if (payload == NULL)
+        return;
+    n = payload - event;
+    payload += (payload[1] == ' ') ? 2 : 1;
+    c = &cpus[cpu];
+
+    if (n == 12 && strncmp(event, "sched_switch", n) == 0) {
+        account(cpu, ts);
+        switched_in(c, payload);
+    } else if (n == 17 && strncmp(event, "irq_handler_entry", n) == 0) {
+        account(cpu, ts);
+        if (sscanf(payload, "irq=%d name=%31s", &pid, irq) == 2)
+            snprintf(name, sizeof(name), "irq/%d %s", pid, irq);
+        else
+            snprintf(name, sizeof(name), "irq");
+        push(c, name);
+    } else if (n == 13 && strncmp(event, "softirq_entry", n) == 0) {
+        account(cpu, ts);
+        if ((p = strstr(payload, "action=")) != NULL && sscanf(p, "action=%31[A-Z_]", irq) == 1)
+            snprintf(name, sizeof(name), "softirq %s", irq);
+        else
+            snprintf(name, sizeof(name), "softirq");
+        push(c, name);
+    } else if ((n == 16 && strncmp(event, "irq_handler_exit", n) == 0) ||
+               (n == 12 && strncmp(event, "softirq_exit", n) == 0)) {
+        account(cpu, ts);
+        pop(c);
+    } else if ((n == 18 && strncmp(event, "tracing_mark_write", n) == 0) ||
+               (n == 5 && strncmp(event, "print", n) == 0)) {
+        // trace-cmd prints the kernel's "tracing_mark_write: " prefix inside print events
+        if (strncmp(payload, "tracing_mark_write: ", 20) == 0)
+            payload += 20;
+        while (*payload == ' ')
+            payload++;
+        marker(payload, cpu, pid, ts);
+    }
+}
+
+static void report(void) {
+    release_t *rel;
+    svc_t *svc;
+    int s, i, j;
+
+    for (s = 0; s < MAX_SVC; s++) {
+        svc = &svcs[s];
+        if (svc->releases == 0)
+            continue;
+
+        printf("S%d: %llu releases, %llu started, %llu never started, %llu deadline misses", s,
+               svc->releases, svc->started, svc->overruns, svc->misses);
+        if (svc->started > 0)
+            printf(", latency mean %.1f us max %.1f us", svc->latency_sum_ns / (svc->started * 1000.0),
+                   svc->latency_max_ns / 1000.0);
+        if (svc->unmatched > 0)
+            printf(", %llu starts of no open release", svc->unmatched);
+        printf("\n");
+
+        qsort(svc->totals, svc->ntotals, sizeof(total_t), totals_desc);
+        printf("  Held the service's core between release and start, all releases:\n");
+        for (i = 0; i < svc->ntotals; i++)
+            printf("    %-40s %12.1f us in %llu releases\n", svc->totals[i].name, svc->totals[i].ns / 1000.0,
+                   svc->totals[i].releases);
+
+        printf("  Worst releases:\n");
+        for (i = 0; i < svc->nworst; i++) {
+            rel = &svc->worst[i];
+            printf("    #%-8llu %10.1f us on core %d:", rel->seq, rel->latency_ns / 1000.0, rel->cpu);
+            for (j = 0; j < rel->nshares; j++)
+                printf("%s %s %.1f us", j ? "," : "", rel->shares[j].name, rel->shares[j].ns / 1000.0);
+            printf("\n");
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    char *line = NULL;
+    size_t cap = 0;
+    FILE *in = stdin;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "w:")) != -1) {
+        switch (opt) {
+        case 'w':
+            max_worst = atoi(optarg);
+            if (max_worst < 1) {
+                printf("-w needs at least 1 release to keep\n");
+                return -1;
+            }
+            if (max_worst > MAX_WORST)
+                max_worst = MAX_WORST;
+            break;
+        default:
+            printf("Usage: %s [-w worst] [trace.txt]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    if (optind < argc && (in = fopen(argv[optind], "r")) == NULL) {
+        perror(argv[optind]);
+        return -1;
+    }
+
+    while (getline(&line, &cap, in) > 0)
+        parse_line(line);
+
+    report();
+
+    free(line);
+    if (in != stdin)
+        fclose(in);
+    return 0;
+}
@@ -0,0 +1,205 @@
+/**
+ * File: offload_pool.c
+ * Author: Brad Waggle
+ * Description: Bounded queue and SCHED_OTHER worker pool for best-effort
+ *              service work (file writes, socket sends).
+ * Date: October 18, 2026
+ */
+
+// Best-effort services are still released by the sequencer, but instead of
+// doing their I/O on an RT thread they only enqueue a job here. The enqueue
+// never blocks: it claims a cell with a CAS and posts a semaphore, and when
+// the queue is full the job is refused and counted as a drop. The workers
+// run as SCHED_OTHER on the cores not used by the RT services, so a slow
+// disk or socket only ever delays other best-effort work.
+//
+// The queue is a bounded multi-producer/multi-consumer ring where each cell
+// carries a turn counter (D. Vyukov's design), so producers on different
+// cores never take a lock.
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/sysinfo.h>
+#include "offload_pool.h"
+
+// Take the next job off the queue, returns 0 when the queue is empty
+static int offload_take(offload_pool_t *pool, offload_fn_t *fn, void **arg) {
+    unsigned long long pos = atomic_load_explicit(&pool->dequeue_pos, memory_order_relaxed);
+    offload_cell_t *cell;
+    long long diff;
+
+    for (;;) {
+        cell = &pool->cells[pos & OFFLOAD_QUEUE_MASK];
+        diff = (long long)atomic_load_explicit(&cell->seq, memory_order_acquire) - (long long)(pos + 1);
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&pool->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            // Empty, or a producer claimed this cell and has not published it yet while a
+            // later one already posted. The token taken is for a queued job, wait for it.
+            if (atomic_load_explicit(&pool->enqueue_pos, memory_order_relaxed) == pos)
+                return 0;
+            sched_yield();
+            pos = atomic_load_explicit(&pool->dequeue_pos, memory_order_relaxed);
+        } else {
+            pos = atomic_load_explicit(&pool->dequeue_pos, memory_order_relaxed);
+        }
+    }
+
+    *fn = cell->fn;
+    *arg = cell->arg;
+    atomic_store_explicit(&cell->seq, pos + OFFLOAD_QUEUE_DEPTH, memory_order_release);
+
+    return 1;
+}
+
+// Worker thread, sleeps on the semaphore and runs jobs until stopped and drained
+static void *offload_worker(void *threadp) {
+    offload_pool_t *pool = (offload_pool_t *)threadp;
+    offload_fn_t fn;
+    void *arg;
+
+    for (;;) {
+        while (sem_wait(&pool->work) != 0 && errno == EINTR)
+            ;
+
+        if (offload_take(pool, &fn, &arg)) {
+            fn(arg);
+            atomic_fetch_add_explicit(&pool->completed, 1, memory_order_relaxed);
+        } else if (atomic_load(&pool->stop)) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+// Start the workers on every online core that is not in rt_cpus.
+// When all cores are RT cores the workers share them at SCHED_OTHER.
+int offload_pool_start(offload_pool_t *pool, int num_workers, const cpu_set_t *rt_cpus) {
+    pthread_attr_t attr;
+    struct sched_param param;
+    int i, rc;
+
+    memset(pool, 0, sizeof(*pool));
+
+    if (num_workers > OFFLOAD_MAX_WORKERS)
+        num_workers = OFFLOAD_MAX_WORKERS;
+
+    for (i = 0; i < OFFLOAD_QUEUE_DEPTH; i++)
+        atomic_init(&pool->cells[i].seq, i);
+
+    if (sem_init(&pool->work, 0, 0)) {
+        printf("Failed to initialize offload pool semaphore\n");
+        return -1;
+    }
+
+    CPU_ZERO(&pool->worker_cpus);
+    for (i = 0; i < get_nprocs(); i++)
+        if (rt_cpus == NULL || !CPU_ISSET(i, rt_cpus))
+            CPU_SET(i, &pool->worker_cpus);
+
+    if (CPU_COUNT(&pool->worker_cpus) == 0) {
+        printf("No non-RT cores left, offload workers share the RT cores\n");
+        for (i = 0; i < get_nprocs(); i++)
+            CPU_SET(i, &pool->worker_cpus);
+    }
+
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+    param.sched_priority = 0;
+    pthread_attr_setschedparam(&attr, &param);
+    pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &pool->worker_cpus);
+
+    for (i = 0; i < num_workers; i++) {
+        rc = pthread_create(&pool->workers[i], &attr, offload_worker, (void *)pool);
+        if (rc != 0) {
+            printf("pthread_create for offload worker %d failed: %s\n", i, strerror(rc));
+            break;
+        }
+        pool->num_workers++;
+    }
+
+    pthread_attr_destroy(&attr);
+
+    printf("Offload pool started %d SCHED_OTHER workers on %d cores\n",
+           pool->num_workers, CPU_COUNT(&pool->worker_cpus));
+
+    return (pool->num_workers > 0) ? 0 : -1;
+}
+
+// Queue a job from an RT service, never blocks.
+// Returns -1 and counts a drop when the queue is full.
+int offload_submit(offload_pool_t *pool, offload_fn_t fn, void *arg) {
+    unsigned long long pos = atomic_load_explicit(&pool->enqueue_pos, memory_order_relaxed);
+    unsigned long long depth, high_water;
+    offload_cell_t *cell;
+    long long diff;
+
+    for (;;) {
+        cell = &pool->cells[pos & OFFLOAD_QUEUE_MASK];
+        diff = (long long)atomic_load_explicit(&cell->seq, memory_order_acquire) - (long long)pos;
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&pool->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            atomic_fetch_add_explicit(&pool->dropped, 1, memory_order_relaxed);
+            return -1;
+        } else {
+            pos = atomic_load_explicit(&pool->enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    cell->fn = fn;
+    cell->arg = arg;
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+
+    atomic_fetch_add_explicit(&pool->submitted, 1, memory_order_relaxed);
+
+    depth = offload_pool_depth(pool);
+    high_water = atomic_load_explicit(&pool->high_water, memory_order_relaxed);
+    while (depth > high_water &&
+           !atomic_compare_exchange_weak_explicit(&pool->high_water, &high_water, depth,
+                                                  memory_order_relaxed, memory_order_relaxed))
+        ;
+
+    sem_post(&pool->work);
+
+    return 0;
+}
+
+// Jobs queued but not yet taken by a worker, lets services shed load early
+unsigned int offload_pool_depth(offload_pool_t *pool) {
+    unsigned long long enq = atomic_load_explicit(&pool->enqueue_pos, memory_order_relaxed);
+    unsigned long long deq = atomic_load_explicit(&pool->dequeue_pos, memory_order_relaxed);
+
+    return (enq > deq) ? (unsigned int)(enq - deq) : 0;
+}
+
+// Let the workers drain the queue, then join them
+void offload_pool_stop(offload_pool_t *pool) {
+    int i;
+
+    atomic_store(&pool->stop, 1);
+    for (i = 0; i < pool->num_workers; i++)
+        sem_post(&pool->work);
+
+    for (i = 0; i < pool->num_workers; i++)
+        pthread_join(pool->workers[i], NULL);
+
+    sem_destroy(&pool->work);
+}
+
+void offload_pool_report(offload_pool_t *pool) {
+    printf("Offload pool: submitted=%llu completed=%llu dropped=%llu high_water=%llu/%d\n",
+           atomic_load(&pool->submitted), atomic_load(&pool->completed),
+           atomic_load(&pool->dropped), atomic_load(&pool->high_water), OFFLOAD_QUEUE_DEPTH);
+}
@@ -0,0 +1,50 @@
+#ifndef OFFLOAD_POOL_H
+#define OFFLOAD_POOL_H
+
+// cpu_set_t needs _GNU_SOURCE defined before the first system include
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+
+// Queue depth, must be a power of 2
+#define OFFLOAD_QUEUE_DEPTH (64)
+#define OFFLOAD_QUEUE_MASK (OFFLOAD_QUEUE_DEPTH - 1)
+
+#define OFFLOAD_MAX_WORKERS (4)
+
+// Work submitted by a best-effort service, run later on a worker thread
+typedef void (*offload_fn_t)(void *arg);
+
+typedef struct
+{
+    atomic_ullong seq;              // cell turn, see offload_submit()
+    offload_fn_t fn;
+    void *arg;
+} offload_cell_t;
+
+typedef struct
+{
+    offload_cell_t cells[OFFLOAD_QUEUE_DEPTH];
+    atomic_ullong enqueue_pos;
+    atomic_ullong dequeue_pos;
+    sem_t work;                     // one count per queued job plus stop tokens
+    atomic_int stop;
+
+    pthread_t workers[OFFLOAD_MAX_WORKERS];
+    int num_workers;
+    cpu_set_t worker_cpus;
+
+    atomic_ullong submitted;        // jobs accepted
+    atomic_ullong completed;        // jobs run to completion
+    atomic_ullong dropped;          // jobs refused because the queue was full
+    atomic_ullong high_water;       // deepest queue seen
+} offload_pool_t;
+
+int offload_pool_start(offload_pool_t *pool, int num_workers, const cpu_set_t *rt_cpus);
+int offload_submit(offload_pool_t *pool, offload_fn_t fn, void *arg);
+unsigned int offload_pool_depth(offload_pool_t *pool);
+void offload_pool_stop(offload_pool_t *pool);
+void offload_pool_report(offload_pool_t *pool);
+
+#endif
@@ -0,0 +1,106 @@
+/**
+ * File: rt_cycles.c
+ * Author: Brad Waggle
+ * Description: Picks and calibrates the cycle counter behind rt_cycles_now().
+ * Date: October 18, 2026
+ */
+
+// The counter is chosen at run time: an x86 TSC that CPUID does not mark
+// invariant changes rate with the core clock and stops in deep idle, so
+// it is not used. The rate is measured, not taken from the CPU's nominal
+// frequency, by reading the counter between two clock reads at the start
+// and the end of RT_CYCLES_CAL_MS. Keeping the tightest bracket of a few
+// tries takes a preemption or an interrupt out of the measurement.
+//
+// rt_cycles_report() prints the counter, its rate and how far
+// rt_cycles_now() has drifted from CLOCK_MONOTONIC since calibration,
+// which is the calibration error over the run.
+
+#include <stdio.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+#include "rt_cycles.h"
+
+rt_cycles_cal_t rt_cycles_cal = { RT_CYCLES_CLOCK, 0, RT_NSEC_PER_SEC, 1ULL << RT_CYCLES_SHIFT, 0, 0 };
+
+static rt_cycles_source_t detect(int *ordered) {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx, max_ext;
+
+    *ordered = 0;
+    if (!__get_cpuid(0x80000000, &max_ext, &ebx, &ecx, &edx) || max_ext < 0x80000007)
+        return RT_CYCLES_CLOCK;
+    if (__get_cpuid(0x80000001, &eax, &ebx, &ecx, &edx))
+        *ordered = (edx >> 27) & 1;
+    // Invariant TSC, CPUID.80000007H:EDX[8]
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return ((edx >> 8) & 1) ? RT_CYCLES_TSC : RT_CYCLES_CLOCK;
+#elif defined(__aarch64__)
+    *ordered = 1;
+    return RT_CYCLES_CNTVCT;
+#else
+    *ordered = 0;
+    return RT_CYCLES_CLOCK;
+#endif
+}
+
+// A counter read and the clock time at the middle of the tightest bracket,
+// the first try always counts so the outputs are set
+static void sample(clockid_t clock, uint64_t *cycles, rt_ns_t *ns) {
+    rt_ns_t before, after, best = RT_TIME_MAX;
+    uint64_t c;
+    int i;
+
+    for (i = 0; i < RT_CYCLES_CAL_TRIES; i++) {
+        before = rt_time_now(clock);
+        c = rt_cycles_read_counter_ordered();
+        after = rt_time_now(clock);
+        if (i == 0 || after - before < best) {
+            best = after - before;
+            *cycles = c;
+            *ns = before + best / 2;
+        }
+    }
+}
+
+// Returns -1 and leaves rt_cycles_now() on clock_gettime() without a usable counter
+int rt_cycles_init(void) {
+    struct timespec wait = { 0, RT_CYCLES_CAL_MS * RT_NSEC_PER_MSEC };
+    uint64_t c0, c1;
+    rt_ns_t t0, t1;
+    int ordered;
+
+    rt_cycles_cal.source = detect(&ordered);
+    rt_cycles_cal.ordered = ordered;
+    if (rt_cycles_cal.source == RT_CYCLES_CLOCK)
+        return -1;
+
+    sample(CLOCK_MONOTONIC_RAW, &c0, &t0);
+    while (clock_nanosleep(CLOCK_MONOTONIC, 0, &wait, &wait) != 0)
+        ;
+    sample(CLOCK_MONOTONIC_RAW, &c1, &t1);
+    if (c1 <= c0 || t1 <= t0) {
+        printf("Cycle counter did not advance, using clock_gettime\n");
+        rt_cycles_cal.source = RT_CYCLES_CLOCK;
+        return -1;
+    }
+
+    rt_cycles_cal.hz = (uint64_t)((unsigned __int128)(c1 - c0) * RT_NSEC_PER_SEC / (t1 - t0));
+    rt_cycles_cal.mult = (uint64_t)(((unsigned __int128)(t1 - t0) << RT_CYCLES_SHIFT) / (c1 - c0));
+    sample(CLOCK_MONOTONIC, &rt_cycles_cal.base_cycles, &rt_cycles_cal.base_ns);
+    return 0;
+}
+
+void rt_cycles_report(void) {
+    static const char *names[] = { "none, clock_gettime", "TSC", "CNTVCT_EL0" };
+
+    if (rt_cycles_cal.source == RT_CYCLES_CLOCK) {
+        printf("Cycle counter: %s\n", names[RT_CYCLES_CLOCK]);
+        return;
+    }
+    printf("Cycle counter: %s%s %.3f MHz, %.3f ns per tick, %+lld ns from CLOCK_MONOTONIC since calibration\n",
+           names[rt_cycles_cal.source], (rt_cycles_cal.source == RT_CYCLES_TSC && rt_cycles_cal.ordered) ? " (rdtscp)" : "",
+           rt_cycles_cal.hz / 1e6, 1e9 / rt_cycles_cal.hz, (long long)(rt_cycles_now() - rt_time_mono()));
+}
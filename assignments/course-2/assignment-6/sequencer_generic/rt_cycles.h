@@ -0,0 +1,101 @@
+#ifndef RT_CYCLES_H
+#define RT_CYCLES_H
+
+#include <stdint.h>
+#include "rt_time.h"
+
+// Time-stamps from the CPU's free-running counter, calibrated once at
+// start. x86 reads the TSC (rdtsc, or rdtscp where the read must not move
+// ahead of earlier loads), used only when CPUID says it is invariant: it
+// ticks at one rate through frequency changes and deep idle. AArch64 reads
+// CNTVCT_EL0, the generic timer the kernel lets user space read. Either is
+// a few nanoseconds, no system call and no kernel module.
+//
+// rt_cycles_init() measures the counter against CLOCK_MONOTONIC_RAW, which
+// NTP does not slew, and keeps ns = (cycles * mult) >> shift, one multiply
+// and one shift per conversion. rt_cycles_now() is anchored to
+// CLOCK_MONOTONIC at calibration, so its times line up with rt_time_mono()
+// from the rest of the run. Without a usable counter every read falls back
+// to clock_gettime(CLOCK_MONOTONIC).
+#define RT_CYCLES_CAL_MS (50)           // calibration interval
+#define RT_CYCLES_CAL_TRIES (16)        // clock reads bracketing each counter read, the tightest is kept
+#define RT_CYCLES_SHIFT (32)
+
+typedef enum
+{
+    RT_CYCLES_CLOCK = 0,                // no usable counter, clock_gettime()
+    RT_CYCLES_TSC,                      // x86 invariant TSC
+    RT_CYCLES_CNTVCT                    // AArch64 virtual count
+} rt_cycles_source_t;
+
+typedef struct
+{
+    rt_cycles_source_t source;
+    int ordered;                        // rdtscp available
+    uint64_t hz;                        // measured counter rate
+    uint64_t mult;                      // ns per cycle << RT_CYCLES_SHIFT
+    uint64_t base_cycles;               // counter at base_ns
+    rt_ns_t base_ns;                    // CLOCK_MONOTONIC at the end of calibration
+} rt_cycles_cal_t;
+
+extern rt_cycles_cal_t rt_cycles_cal;
+
+int rt_cycles_init(void);
+void rt_cycles_report(void);
+
+static inline uint64_t rt_cycles_read_counter(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi;
+
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return (uint64_t)hi << 32 | lo;
+#elif defined(__aarch64__)
+    uint64_t cnt;
+
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(cnt));
+    return cnt;
+#else
+    return 0;
+#endif
+}
+
+// Waits for earlier instructions, for the end of a timed section
+static inline uint64_t rt_cycles_read_counter_ordered(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi, aux;
+
+    if (rt_cycles_cal.ordered) {
+        __asm__ volatile("rdtscp" : "=a"(lo), "=d"(hi), "=c"(aux));
+        return (uint64_t)hi << 32 | lo;
+    }
+    __asm__ volatile("lfence" ::: "memory");
+    return rt_cycles_read_counter();
+#elif defined(__aarch64__)
+    uint64_t cnt;
+
+    __asm__ volatile("isb; mrs %0, cntvct_el0" : "=r"(cnt) :: "memory");
+    return cnt;
+#else
+    return 0;
+#endif
+}
+
+// Counter ticks to nanoseconds, the product is 128-bit so no count overflows
+static inline rt_ns_t rt_cycles_to_ns(uint64_t cycles) {
+    return (rt_ns_t)(((unsigned __int128)cycles * rt_cycles_cal.mult) >> RT_CYCLES_SHIFT);
+}
+
+// CLOCK_MONOTONIC time from the counter
+static inline rt_ns_t rt_cycles_now(void) {
+    int64_t delta;
+
+    if (rt_cycles_cal.source == RT_CYCLES_CLOCK)
+        return rt_time_mono();
+    // Another core's counter may be a little behind the calibrating core's
+    delta = (int64_t)(rt_cycles_read_counter() - rt_cycles_cal.base_cycles);
+    if (delta < 0)
+        return rt_cycles_cal.base_ns - rt_cycles_to_ns(-delta);
+    return rt_cycles_cal.base_ns + rt_cycles_to_ns(delta);
+}
+
+#endif
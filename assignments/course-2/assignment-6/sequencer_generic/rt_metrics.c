@@ -0,0 +1,205 @@
+/**
+ * File: rt_metrics.c
+ * Author: Brad Waggle
+ * Description: Live per-service metrics in a POSIX shared memory segment
+ *              for rtstat to watch.
+ * Date: October 18, 2026
+ */
+
+// Tailing syslog to see how a run is going costs the system a message per
+// release. Here each service slot in a shm_open() segment holds two halves,
+// one the sequencer writes when it releases the service and one the service
+// writes when it completes, so every half has a single writer. Both are
+// seqlocks laid out like mailbox.c: the writer makes the sequence number
+// odd, stores the words and makes it even again, with no system call, lock
+// or wait. Each half sits on its own cache line.
+//
+// The writers keep their running values (maxima, jitter, totals) in
+// process-private copies and only store to the segment. A reader maps it
+// read-only, retries a copy that overlapped a write and works out backlog
+// and utilization itself.
+//
+// Jitter is the change in release latency from one release to the next,
+// smoothed over 16 releases like the RTP interarrival jitter of RFC 3550.
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "rt_metrics.h"
+#include "rt_time.h"
+
+#define RELEASE_WORDS (sizeof(((rt_metrics_svc_t *)0)->release) / sizeof(unsigned long long))
+#define RUN_WORDS (sizeof(((rt_metrics_svc_t *)0)->run) / sizeof(unsigned long long))
+
+static rt_metrics_seg_t *seg;
+static int nslots;
+
+// Writer-side copies of what is published
+static rt_metrics_release_t release_state[RT_METRICS_MAX_SVC];
+static rt_metrics_run_t run_state[RT_METRICS_MAX_SVC];
+
+static void publish(atomic_uint *seq, atomic_ullong *words, const void *value, size_t size, unsigned int nwords) {
+    unsigned long long buf[RUN_WORDS > RELEASE_WORDS ? RUN_WORDS : RELEASE_WORDS] = { 0 };
+    unsigned int s = atomic_load_explicit(seq, memory_order_relaxed);
+    unsigned int i;
+
+    memcpy(buf, value, size);
+
+    atomic_store_explicit(seq, s + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    for (i = 0; i < nwords; i++)
+        atomic_store_explicit(&words[i], buf[i], memory_order_relaxed);
+
+    atomic_store_explicit(seq, s + 2, memory_order_release);
+}
+
+static void consume(const atomic_uint *seq, const atomic_ullong *words, void *value, size_t size, unsigned int nwords) {
+    unsigned long long buf[RUN_WORDS > RELEASE_WORDS ? RUN_WORDS : RELEASE_WORDS];
+    unsigned int start, end, i;
+
+    for (;;) {
+        start = atomic_load_explicit((atomic_uint *)seq, memory_order_acquire);
+        if ((start & 1) == 0) {
+            for (i = 0; i < nwords; i++)
+                buf[i] = atomic_load_explicit((atomic_ullong *)&words[i], memory_order_relaxed);
+
+            atomic_thread_fence(memory_order_acquire);
+            end = atomic_load_explicit((atomic_uint *)seq, memory_order_relaxed);
+            if (start == end)
+                break;
+        }
+        sched_yield();
+    }
+
+    memcpy(value, buf, size);
+}
+
+// Create (or take over a stale) segment for nsvc slots and map it locked
+int rt_metrics_open(int nsvc, unsigned long long period_ns) {
+    int fd, i;
+
+    if (nsvc > RT_METRICS_MAX_SVC) {
+        printf("rt_metrics: %d services is over the limit of %d\n", nsvc, RT_METRICS_MAX_SVC);
+        return -1;
+    }
+
+    fd = shm_open(RT_METRICS_NAME, O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror("rt_metrics shm_open");
+        return -1;
+    }
+    if (ftruncate(fd, sizeof(rt_metrics_seg_t)) != 0) {
+        perror("rt_metrics ftruncate");
+        close(fd);
+        return -1;
+    }
+
+    seg = mmap(NULL, sizeof(rt_metrics_seg_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (seg == MAP_FAILED) {
+        perror("rt_metrics mmap");
+        seg = NULL;
+        return -1;
+    }
+    if (mlock(seg, sizeof(rt_metrics_seg_t)) != 0)
+        perror("rt_metrics mlock");
+
+    // Readers check the magic last, so fill everything else first
+    atomic_store_explicit(&seg->magic, 0, memory_order_relaxed);
+    memset(&seg->version, 0, sizeof(rt_metrics_seg_t) - offsetof(rt_metrics_seg_t, version));
+    memset(release_state, 0, sizeof(release_state));
+    memset(run_state, 0, sizeof(run_state));
+    for (i = 0; i < RT_METRICS_MAX_SVC; i++)
+        run_state[i].cpu = -1;
+
+    seg->version = RT_METRICS_VERSION;
+    seg->nsvc = nsvc;
+    seg->pid = getpid();
+    seg->start_ns = rt_time_mono();
+    seg->period_ns = period_ns;
+    nslots = nsvc;
+    for (i = 0; i < nsvc; i++)
+        publish(&seg->svc[i].run_seq, seg->svc[i].run, &run_state[i], sizeof(rt_metrics_run_t), RUN_WORDS);
+    atomic_store_explicit(&seg->magic, RT_METRICS_MAGIC, memory_order_release);
+
+    return 0;
+}
+
+void rt_metrics_name(int svc, const char *name) {
+    if (seg == NULL || svc < 0 || svc >= nslots)
+        return;
+    snprintf(seg->svc[svc].name, RT_METRICS_NAME_LEN, "%s", name);
+}
+
+// Called by the sequencer for every release it issues
+void rt_metrics_released(int svc, unsigned long long release_ns, int missed) {
+    rt_metrics_release_t *st;
+
+    if (seg == NULL || svc < 0 || svc >= nslots)
+        return;
+    st = &release_state[svc];
+
+    st->released++;
+    st->missed += (missed != 0);
+    st->release_ns = release_ns;
+    publish(&seg->svc[svc].release_seq, seg->svc[svc].release, st, sizeof(*st), RELEASE_WORDS);
+}
+
+// Called by the service when it completes a release, latency 0 if unknown
+void rt_metrics_completed(int svc, unsigned long long latency_ns, unsigned long long exec_ns) {
+    rt_metrics_run_t *st;
+    long long change;
+
+    if (seg == NULL || svc < 0 || svc >= nslots)
+        return;
+    st = &run_state[svc];
+
+    if (st->completed > 0 && latency_ns != 0) {
+        change = (long long)latency_ns - (long long)st->latency_ns;
+        if (change < 0)
+            change = -change;
+        st->jitter_ns += ((long long)change - (long long)st->jitter_ns) / 16;
+    }
+
+    st->completed++;
+    if (latency_ns != 0) {
+        st->latency_ns = latency_ns;
+        if (latency_ns > st->max_latency_ns)
+            st->max_latency_ns = latency_ns;
+    }
+    st->exec_ns = exec_ns;
+    if (exec_ns > st->max_exec_ns)
+        st->max_exec_ns = exec_ns;
+    st->busy_ns += exec_ns;
+    st->cpu = sched_getcpu();
+
+    publish(&seg->svc[svc].run_seq, seg->svc[svc].run, st, sizeof(*st), RUN_WORDS);
+}
+
+// Unmap and remove the segment, a viewer still attached keeps the last numbers
+void rt_metrics_close(void) {
+    if (seg == NULL)
+        return;
+
+    munlock(seg, sizeof(rt_metrics_seg_t));
+    munmap(seg, sizeof(rt_metrics_seg_t));
+    seg = NULL;
+    shm_unlink(RT_METRICS_NAME);
+}
+
+void rt_metrics_read_release(const rt_metrics_svc_t *slot, rt_metrics_release_t *out) {
+    consume(&slot->release_seq, slot->release, out, sizeof(*out), RELEASE_WORDS);
+}
+
+void rt_metrics_read_run(const rt_metrics_svc_t *slot, rt_metrics_run_t *out) {
+    consume(&slot->run_seq, slot->run, out, sizeof(*out), RUN_WORDS);
+}
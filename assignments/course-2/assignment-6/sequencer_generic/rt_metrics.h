@@ -0,0 +1,70 @@
+#ifndef RT_METRICS_H
+#define RT_METRICS_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+
+// POSIX shared memory name of the live metrics segment
+#define RT_METRICS_NAME "/seqgen_metrics"
+
+#define RT_METRICS_MAGIC (0x5254534dU)     // "MSTR"
+#define RT_METRICS_VERSION (1)
+#define RT_METRICS_MAX_SVC (16)
+#define RT_METRICS_NAME_LEN (16)
+
+// What the sequencer publishes about its releases of one service
+typedef struct
+{
+    unsigned long long released;        // releases issued
+    unsigned long long missed;          // releases still running at the next one (D=T)
+    unsigned long long release_ns;      // CLOCK_MONOTONIC time of the latest release
+} rt_metrics_release_t;
+
+// What the service publishes about its own releases
+typedef struct
+{
+    unsigned long long completed;       // releases finished
+    unsigned long long latency_ns;      // release to start of the latest release
+    unsigned long long max_latency_ns;
+    unsigned long long jitter_ns;       // smoothed change in latency between releases
+    unsigned long long exec_ns;         // latest execution time
+    unsigned long long max_exec_ns;
+    unsigned long long busy_ns;         // total execution time, for CPU utilization
+    int cpu;                            // core the latest release ran on
+} rt_metrics_run_t;
+
+// Each half has one writer, the sequencer or the service, and its own
+// seqlock: odd while a write is in progress
+typedef struct
+{
+    char name[RT_METRICS_NAME_LEN];
+    _Alignas(64) atomic_uint release_seq;
+    atomic_ullong release[sizeof(rt_metrics_release_t) / sizeof(unsigned long long)];
+    _Alignas(64) atomic_uint run_seq;
+    atomic_ullong run[(sizeof(rt_metrics_run_t) + 7) / sizeof(unsigned long long)];
+} rt_metrics_svc_t;
+
+typedef struct
+{
+    atomic_uint magic;                  // RT_METRICS_MAGIC once the segment is set up
+    uint32_t version;
+    uint32_t nsvc;
+    pid_t pid;                          // process that publishes
+    uint64_t start_ns;                  // CLOCK_MONOTONIC time the segment was created
+    uint64_t period_ns;                 // sequencer period
+    rt_metrics_svc_t svc[RT_METRICS_MAX_SVC];
+} rt_metrics_seg_t;
+
+// Publisher side
+int rt_metrics_open(int nsvc, unsigned long long period_ns);
+void rt_metrics_name(int svc, const char *name);
+void rt_metrics_released(int svc, unsigned long long release_ns, int missed);
+void rt_metrics_completed(int svc, unsigned long long latency_ns, unsigned long long exec_ns);
+void rt_metrics_close(void);
+
+// Reader side, work on a segment mapped read-only
+void rt_metrics_read_release(const rt_metrics_svc_t *slot, rt_metrics_release_t *out);
+void rt_metrics_read_run(const rt_metrics_svc_t *slot, rt_metrics_run_t *out);
+
+#endif
@@ -0,0 +1,232 @@
+/**
+ * File: rt_pool.c
+ * Author: Brad Waggle
+ * Description: Preallocated object pools and per-release arenas so that
+ *              RT services never call malloc.
+ * Date: October 18, 2026
+ */
+
+// All memory is reserved, touched and locked at startup, so neither kind of
+// allocator can take a page fault or a lock in an RT path.
+//
+// Pools hand out fixed-size objects from a lock-free free list (a Treiber
+// stack of indices with an ABA tag), so one service can allocate a message
+// and another service or a worker can free it, both in O(1).
+//
+// Arenas belong to a single service and are reset at the start of each
+// release, giving that release scratch space with a pointer bump.
+//
+// Both keep high-water marks so the reservations can be sized from real runs.
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "rt_pool.h"
+
+#define RT_ARENA_ALIGN (16)
+
+// Reserve, prefault and lock a block of memory
+static void *reserve(size_t size) {
+    void *mem;
+
+    if (posix_memalign(&mem, sysconf(_SC_PAGESIZE), size) != 0)
+        return NULL;
+
+    memset(mem, 0, size);
+    if (mlock(mem, size) != 0)
+        perror("rt_pool mlock");
+
+    return mem;
+}
+
+int rt_pool_init(rt_pool_t *pool, const char *name, size_t obj_size, unsigned int capacity) {
+    unsigned int i;
+
+    memset(pool, 0, sizeof(*pool));
+    pool->name = name;
+    pool->obj_size = (obj_size + RT_ARENA_ALIGN - 1) & ~(size_t)(RT_ARENA_ALIGN - 1);
+    pool->capacity = capacity;
+
+    pool->mem = reserve(pool->obj_size * capacity);
+    pool->next = reserve(sizeof(uint32_t) * capacity);
+    if (pool->mem == NULL || pool->next == NULL) {
+        printf("Failed to reserve pool %s\n", name);
+        return -1;
+    }
+
+    // Free list runs 0, 1, 2, ... so early allocations are cache-adjacent
+    for (i = 0; i < capacity; i++)
+        pool->next[i] = (i + 1 < capacity) ? i + 2 : 0;
+    atomic_init(&pool->head, (capacity > 0) ? 1 : 0);
+
+    return 0;
+}
+
+void *rt_pool_alloc(rt_pool_t *pool) {
+    unsigned long long old = atomic_load_explicit(&pool->head, memory_order_acquire);
+    unsigned long long new;
+    unsigned int idx, in_use, high_water;
+
+    do {
+        idx = (unsigned int)(old & 0xffffffffULL);
+        if (idx == 0) {
+            atomic_fetch_add_explicit(&pool->failures, 1, memory_order_relaxed);
+            return NULL;
+        }
+        new = (((old >> 32) + 1) << 32) | pool->next[idx - 1];
+    } while (!atomic_compare_exchange_weak_explicit(&pool->head, &old, new,
+                                                    memory_order_acquire, memory_order_acquire));
+
+    in_use = atomic_fetch_add_explicit(&pool->in_use, 1, memory_order_relaxed) + 1;
+    high_water = atomic_load_explicit(&pool->high_water, memory_order_relaxed);
+    while (in_use > high_water &&
+           !atomic_compare_exchange_weak_explicit(&pool->high_water, &high_water, in_use,
+                                                  memory_order_relaxed, memory_order_relaxed))
+        ;
+
+    return pool->mem + ((size_t)(idx - 1) * pool->obj_size);
+}
+
+void rt_pool_free(rt_pool_t *pool, void *obj) {
+    unsigned int idx = (unsigned int)(((unsigned char *)obj - pool->mem) / pool->obj_size) + 1;
+    unsigned long long old = atomic_load_explicit(&pool->head, memory_order_relaxed);
+    unsigned long long new;
+
+    do {
+        pool->next[idx - 1] = (unsigned int)(old & 0xffffffffULL);
+        new = (((old >> 32) + 1) << 32) | idx;
+    } while (!atomic_compare_exchange_weak_explicit(&pool->head, &old, new,
+                                                    memory_order_release, memory_order_relaxed));
+
+    atomic_fetch_sub_explicit(&pool->in_use, 1, memory_order_relaxed);
+}
+
+void rt_pool_report(rt_pool_t *pool) {
+    printf("Pool %s: %u x %zu bytes, in_use=%u high_water=%u failures=%llu\n",
+           pool->name, pool->capacity, pool->obj_size, atomic_load(&pool->in_use),
+           atomic_load(&pool->high_water), atomic_load(&pool->failures));
+}
+
+void rt_pool_destroy(rt_pool_t *pool) {
+    munlock(pool->mem, pool->obj_size * pool->capacity);
+    munlock(pool->next, sizeof(uint32_t) * pool->capacity);
+    free(pool->mem);
+    free(pool->next);
+}
+
+int rt_arena_init(rt_arena_t *arena, const char *name, size_t size) {
+    memset(arena, 0, sizeof(*arena));
+    arena->name = name;
+    arena->size = size;
+
+    arena->mem = reserve(size);
+    if (arena->mem == NULL) {
+        printf("Failed to reserve arena %s\n", name);
+        return -1;
+    }
+
+    return 0;
+}
+
+void *rt_arena_alloc(rt_arena_t *arena, size_t size) {
+    size_t start = (arena->used + RT_ARENA_ALIGN - 1) & ~(size_t)(RT_ARENA_ALIGN - 1);
+
+    if (start + size > arena->size) {
+        arena->failures++;
+        return NULL;
+    }
+
+    arena->used = start + size;
+    if (arena->used > arena->high_water)
+        arena->high_water = arena->used;
+
+    return arena->mem + start;
+}
+
+// Discard everything allocated in the previous release
+void rt_arena_reset(rt_arena_t *arena) {
+    arena->used = 0;
+}
+
+void rt_arena_report(rt_arena_t *arena) {
+    printf("Arena %s: %zu bytes, high_water=%zu failures=%llu\n",
+           arena->name, arena->size, arena->high_water, arena->failures);
+}
+
+void rt_arena_destroy(rt_arena_t *arena) {
+    munlock(arena->mem, arena->size);
+    free(arena->mem);
+}
+
+// Set on every thread that must never touch the heap
+static __thread int rt_thread;
+
+void rt_pool_mark_rt_thread(void) {
+    rt_thread = 1;
+}
+
+void rt_pool_unmark_rt_thread(void) {
+    rt_thread = 0;
+}
+
+#ifdef RT_MALLOC_GUARD
+
+// Interpose the allocator for the whole process. Calls from threads that
+// are not marked go straight to glibc.
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+
+static void rt_heap_violation(const char *fn, size_t size) {
+    char msg[128];
+    int len;
+
+    // Format on the stack and write(2) directly, printf itself may allocate
+    len = snprintf(msg, sizeof(msg), "RT_MALLOC_GUARD: %s(%zu) from RT thread on core %d\n",
+                   fn, size, sched_getcpu());
+    if (len > 0)
+        write(STDERR_FILENO, msg, len);
+
+    abort();
+}
+
+void *malloc(size_t size) {
+    if (rt_thread)
+        rt_heap_violation("malloc", size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+    if (rt_thread)
+        rt_heap_violation("calloc", nmemb * size);
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    if (rt_thread)
+        rt_heap_violation("realloc", size);
+    return __libc_realloc(ptr, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    if (rt_thread)
+        rt_heap_violation("aligned_alloc", size);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size) {
+    if (rt_thread)
+        rt_heap_violation("posix_memalign", size);
+    *memptr = __libc_memalign(alignment, size);
+    return (*memptr == NULL) ? ENOMEM : 0;
+}
+
+#endif
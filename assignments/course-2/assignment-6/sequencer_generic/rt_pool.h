@@ -0,0 +1,54 @@
+#ifndef RT_POOL_H
+#define RT_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+// Fixed-size object pool, any thread may allocate or free
+typedef struct
+{
+    const char *name;
+    unsigned char *mem;             // capacity * obj_size bytes
+    size_t obj_size;
+    unsigned int capacity;
+    uint32_t *next;                 // free list links, index + 1, 0 ends the list
+    atomic_ullong head;             // ABA tag in the upper 32 bits, index + 1 below
+    atomic_uint in_use;
+    atomic_uint high_water;
+    atomic_ullong failures;         // allocations refused because the pool was empty
+} rt_pool_t;
+
+// Bump allocator owned by one service, reset at the start of every release
+typedef struct
+{
+    const char *name;
+    unsigned char *mem;
+    size_t size;
+    size_t used;
+    size_t high_water;
+    unsigned long long failures;
+} rt_arena_t;
+
+int rt_pool_init(rt_pool_t *pool, const char *name, size_t obj_size, unsigned int capacity);
+void *rt_pool_alloc(rt_pool_t *pool);
+void rt_pool_free(rt_pool_t *pool, void *obj);
+void rt_pool_report(rt_pool_t *pool);
+void rt_pool_destroy(rt_pool_t *pool);
+
+int rt_arena_init(rt_arena_t *arena, const char *name, size_t size);
+void *rt_arena_alloc(rt_arena_t *arena, size_t size);
+void rt_arena_reset(rt_arena_t *arena);
+void rt_arena_report(rt_arena_t *arena);
+void rt_arena_destroy(rt_arena_t *arena);
+
+// Mark the calling thread as RT. Built with -DRT_MALLOC_GUARD, any heap
+// allocation from a marked thread prints the culprit and aborts.
+void rt_pool_mark_rt_thread(void);
+
+// Clear the mark once the release loop is done. Thread exit, perror() and
+// syslog() can allocate inside glibc (pthread_exit() loads libgcc_s to
+// unwind), so call this before any of them.
+void rt_pool_unmark_rt_thread(void);
+
+#endif
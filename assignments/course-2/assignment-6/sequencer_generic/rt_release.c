@@ -0,0 +1,111 @@
+/**
+ * File: rt_release.c
+ * Author: Brad Waggle
+ * Description: Service releases as an eventfd for services that wait on
+ *              releases and I/O in one epoll loop.
+ * Date: October 18, 2026
+ */
+
+// A service blocked in sem_wait() cannot also wait for a socket, a pipe or
+// a control message without a helper thread. An eventfd release is a file
+// descriptor, so the service can put it in its own epoll set and take its
+// release, I/O readiness and control messages in one wake-up per batch.
+//
+// The sequencer posts with rt_release_post(), which adds one to the eventfd
+// counter. The service reads the counter when the fd is readable, which
+// takes every pending release at once. More than one means the service fell
+// behind and the extra releases were coalesced, which is counted.
+//
+// Simple services keep the semaphore API. rt_release_wait() blocks on the
+// eventfd alone for a service that wants this mechanism without epoll.
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/eventfd.h>
+#include "rt_release.h"
+#include "rt_time.h"
+
+int rt_release_init(rt_release_t *rel, const char *name) {
+    memset(rel, 0, sizeof(*rel));
+    rel->name = name;
+    atomic_init(&rel->posted, 0);
+    atomic_init(&rel->release_ns, 0);
+
+    // Non-blocking, the service only reads after epoll says it is readable
+    rel->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (rel->fd < 0) {
+        perror("rt_release eventfd");
+        return -1;
+    }
+
+    return 0;
+}
+
+void rt_release_destroy(rt_release_t *rel) {
+    if (rel->fd >= 0)
+        close(rel->fd);
+    rel->fd = -1;
+}
+
+// Called by the sequencer, one release per call
+void rt_release_post(rt_release_t *rel) {
+    uint64_t one = 1;
+
+    atomic_store_explicit(&rel->release_ns, rt_time_mono(), memory_order_relaxed);
+    atomic_fetch_add_explicit(&rel->posted, 1, memory_order_relaxed);
+    if (write(rel->fd, &one, sizeof(one)) != sizeof(one))
+        perror("rt_release post");
+}
+
+// Descriptor to add to the service's epoll set with EPOLLIN
+int rt_release_fd(rt_release_t *rel) {
+    return rel->fd;
+}
+
+// Take all pending releases, returns how many there were, 0 if none
+unsigned long long rt_release_consume(rt_release_t *rel) {
+    unsigned long long released, now, latency;
+    uint64_t count;
+
+    if (read(rel->fd, &count, sizeof(count)) != sizeof(count))
+        return 0;
+
+    // A newer post can land between the read and here, never count that as negative
+    released = atomic_load_explicit(&rel->release_ns, memory_order_relaxed);
+    now = rt_time_mono();
+    latency = (now > released) ? now - released : 0;
+    if (latency > rel->worst_latency_ns)
+        rel->worst_latency_ns = latency;
+
+    rel->wakeups++;
+    rel->consumed += count;
+    rel->coalesced += count - 1;
+
+    return count;
+}
+
+// Block until at least one release is pending and take them all
+unsigned long long rt_release_wait(rt_release_t *rel) {
+    struct pollfd pfd = { .fd = rel->fd, .events = POLLIN };
+    unsigned long long count;
+
+    while ((count = rt_release_consume(rel)) == 0) {
+        if (poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+            perror("rt_release wait");
+            return 0;
+        }
+    }
+
+    return count;
+}
+
+void rt_release_report(rt_release_t *rel) {
+    printf("Release %s: posted=%llu consumed=%llu wakeups=%llu coalesced=%llu worst latency=%.1f us\n",
+           rel->name, atomic_load(&rel->posted), rel->consumed, rel->wakeups, rel->coalesced,
+           rel->worst_latency_ns / 1000.0);
+}
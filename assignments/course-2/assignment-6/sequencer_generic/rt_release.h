@@ -0,0 +1,30 @@
+#ifndef RT_RELEASE_H
+#define RT_RELEASE_H
+
+#include <stdatomic.h>
+
+// Periodic release delivered through an eventfd, so a service can wait for
+// it in epoll alongside its other file descriptors
+typedef struct
+{
+    const char *name;
+    int fd;                             // eventfd, readable while releases are pending
+    atomic_ullong posted;               // releases posted by the sequencer
+    atomic_ullong release_ns;           // CLOCK_MONOTONIC time of the latest post
+    unsigned long long consumed;        // releases taken by the service
+    unsigned long long coalesced;       // releases that arrived while one was still pending
+    unsigned long long wakeups;         // reads that returned at least one release
+    unsigned long long worst_latency_ns; // latest post to the service taking it
+} rt_release_t;
+
+int rt_release_init(rt_release_t *rel, const char *name);
+void rt_release_destroy(rt_release_t *rel);
+
+void rt_release_post(rt_release_t *rel);
+int rt_release_fd(rt_release_t *rel);
+unsigned long long rt_release_consume(rt_release_t *rel);
+unsigned long long rt_release_wait(rt_release_t *rel);
+
+void rt_release_report(rt_release_t *rel);
+
+#endif
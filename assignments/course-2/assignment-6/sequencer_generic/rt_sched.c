@@ -0,0 +1,95 @@
+/**
+ * File: rt_sched.c
+ * Author: Brad Waggle
+ * Description: Timing model of the RT threads and a response time
+ *              schedulability test over their measured execution times.
+ * Date: October 18, 2026
+ */
+
+// Usage:
+//   1) register every RT thread, the sequencer included, with its
+//      SCHED_FIFO priority and period
+//   2) each thread calls rt_service_release_done() at the end of every
+//      release with its execution time
+//   3) rt_sched_analysis() runs response time analysis with C taken from
+//      what the threads actually ran
+//
+// Services share results through mailboxes and the frame ring, which never
+// block, so no service waits on a lock held by another and the analysis
+// has no blocking term. A lock shared between RT services would need
+// PTHREAD_PRIO_INHERIT or PTHREAD_PRIO_PROTECT and its worst critical
+// section added here as B.
+
+#include <stdio.h>
+#include <string.h>
+#include "rt_sched.h"
+
+static rt_service_t services[RT_MAX_SERVICES];
+
+// Add a thread to the timing model
+int rt_service_register(int svc, const char *name, int priority, unsigned long long period_ns) {
+    if (svc < 0 || svc >= RT_MAX_SERVICES) {
+        printf("Service id %d out of range\n", svc);
+        return -1;
+    }
+
+    memset(&services[svc], 0, sizeof(rt_service_t));
+    services[svc].name = name;
+    services[svc].priority = priority;
+    services[svc].period_ns = period_ns;
+
+    return 0;
+}
+
+// Called by a thread at the end of each release with its execution time
+void rt_service_release_done(int svc, unsigned long long exec_ns) {
+    rt_service_t *s;
+
+    if (svc < 0 || svc >= RT_MAX_SERVICES)
+        return;
+    s = &services[svc];
+
+    if (exec_ns > s->wcet_ns)
+        s->wcet_ns = exec_ns;
+    s->releases++;
+}
+
+// Response time analysis, D = T:
+//   R = C + sum over higher or equal priority j of ceil(R / Tj) * Cj
+// Returns the number of services that miss their deadline.
+int rt_sched_analysis(void) {
+    unsigned long long resp, next;
+    int i, j, missed = 0;
+    rt_service_t *s, *hp;
+
+    printf("Schedulability (RTA, times in usec):\n");
+    printf("  %-12s %4s %10s %10s %10s  %s\n", "service", "prio", "T", "C", "R", "result");
+
+    for (i = 0; i < RT_MAX_SERVICES; i++) {
+        s = &services[i];
+        if (s->name == NULL || s->period_ns == 0)
+            continue;
+
+        resp = s->wcet_ns;
+        do {
+            next = s->wcet_ns;
+            for (j = 0; j < RT_MAX_SERVICES; j++) {
+                hp = &services[j];
+                if (j == i || hp->name == NULL || hp->period_ns == 0 || hp->priority < s->priority)
+                    continue;
+                next += ((resp + hp->period_ns - 1) / hp->period_ns) * hp->wcet_ns;
+            }
+            if (next == resp)
+                break;
+            resp = next;
+        } while (resp <= s->period_ns);
+
+        if (resp > s->period_ns)
+            missed++;
+
+        printf("  %-12s %4d %10.1f %10.1f %10.1f  %s\n", s->name, s->priority, s->period_ns / 1000.0,
+               s->wcet_ns / 1000.0, resp / 1000.0, (resp <= s->period_ns) ? "OK" : "MISS");
+    }
+
+    return missed;
+}
@@ -0,0 +1,21 @@
+#ifndef RT_SCHED_H
+#define RT_SCHED_H
+
+#define RT_MAX_SERVICES (16)
+
+// Timing model of one service, C is taken from what it actually ran
+typedef struct
+{
+    const char *name;
+    int priority;                           // SCHED_FIFO priority
+    unsigned long long period_ns;           // T
+    unsigned long long wcet_ns;             // C, worst execution time observed
+    unsigned long long releases;
+} rt_service_t;
+
+int rt_service_register(int svc, const char *name, int priority, unsigned long long period_ns);
+void rt_service_release_done(int svc, unsigned long long exec_ns);
+
+int rt_sched_analysis(void);
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef RT_TIME_H
+#define RT_TIME_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Time as signed 64-bit nanoseconds on a clock the caller names. A reading
+// is clock_gettime() through the vDSO and one multiply-add, inline in the
+// caller, and stays exact however long the system has been up, where a
+// double of seconds since boot loses nanoseconds after a few months.
+// Differences are signed, so a late and an early event read the same way,
+// and the arithmetic saturates at RT_TIME_MAX/RT_TIME_MIN (about 292
+// years) instead of wrapping. Floating point is for printing only.
+typedef int64_t rt_ns_t;
+
+#define RT_NSEC_PER_USEC (1000LL)
+#define RT_NSEC_PER_MSEC (1000000LL)
+#define RT_NSEC_PER_SEC (1000000000LL)
+
+#define RT_TIME_MAX INT64_MAX
+#define RT_TIME_MIN INT64_MIN
+
+static inline rt_ns_t rt_time_add(rt_ns_t a, rt_ns_t b) {
+    rt_ns_t sum;
+
+    if (__builtin_add_overflow(a, b, &sum))
+        return (b > 0) ? RT_TIME_MAX : RT_TIME_MIN;
+    return sum;
+}
+
+static inline rt_ns_t rt_time_sub(rt_ns_t a, rt_ns_t b) {
+    rt_ns_t diff;
+
+    if (__builtin_sub_overflow(a, b, &diff))
+        return (b < 0) ? RT_TIME_MAX : RT_TIME_MIN;
+    return diff;
+}
+
+static inline rt_ns_t rt_time_mul(rt_ns_t a, int64_t k) {
+    rt_ns_t product;
+
+    if (__builtin_mul_overflow(a, k, &product))
+        return ((a < 0) != (k < 0)) ? RT_TIME_MIN : RT_TIME_MAX;
+    return product;
+}
+
+// Any timespec, tv_nsec need not be normalized
+static inline rt_ns_t rt_time_from_ts(const struct timespec *ts) {
+    return rt_time_add(rt_time_mul(ts->tv_sec, RT_NSEC_PER_SEC), ts->tv_nsec);
+}
+
+// Normalized, 0 <= tv_nsec < 1 s also before the epoch, for TIMER_ABSTIME sleeps
+static inline struct timespec rt_time_to_ts(rt_ns_t ns) {
+    struct timespec ts;
+
+    ts.tv_sec = ns / RT_NSEC_PER_SEC;
+    ts.tv_nsec = ns % RT_NSEC_PER_SEC;
+    if (ts.tv_nsec < 0) {
+        ts.tv_sec--;
+        ts.tv_nsec += RT_NSEC_PER_SEC;
+    }
+    return ts;
+}
+
+// stop - start, what delta_t() in the older examples computed
+static inline rt_ns_t rt_time_ts_diff(const struct timespec *stop, const struct timespec *start) {
+    return rt_time_sub(rt_time_from_ts(stop), rt_time_from_ts(start));
+}
+
+static inline rt_ns_t rt_time_now(clockid_t clock) {
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return (rt_ns_t)ts.tv_sec * RT_NSEC_PER_SEC + ts.tv_nsec;
+}
+
+// Intervals and timestamps inside a run
+static inline rt_ns_t rt_time_mono(void) {
+    return rt_time_now(CLOCK_MONOTONIC);
+}
+
+// Wall clock, for log lines and CLOCK_REALTIME sleeps
+static inline rt_ns_t rt_time_real(void) {
+    return rt_time_now(CLOCK_REALTIME);
+}
+
+static inline double rt_time_sec(rt_ns_t ns) {
+    return ns / (double)RT_NSEC_PER_SEC;
+}
+
+#endif
@@ -0,0 +1,147 @@
+/**
+ * File: rtstat.c
+ * Author: Brad Waggle
+ * Description: Live view of a running sequencer from its shared memory
+ *              metrics segment.
+ * Date: October 18, 2026
+ */
+
+// Maps the rt_metrics segment read-only and redraws a table every interval:
+// releases, completions, backlog (released but not completed), deadline
+// misses, release latency, jitter, execution time, the share of one CPU
+// each service used over the last interval and the core it last ran on.
+// Nothing is sent to the sequencer, it does not know it is being watched.
+//
+// Stops when the sequencer exits, after -n refreshes or on Ctrl-C.
+//
+// Usage: rtstat [-i interval_ms] [-n refreshes]
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "rt_metrics.h"
+#include "rt_time.h"
+
+static const rt_metrics_seg_t *attach(void) {
+    const rt_metrics_seg_t *seg;
+    int fd;
+
+    fd = shm_open(RT_METRICS_NAME, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("shm_open " RT_METRICS_NAME " (is the sequencer running?)");
+        return NULL;
+    }
+
+    seg = mmap(NULL, sizeof(rt_metrics_seg_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (seg == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
+    }
+
+    if (atomic_load_explicit((atomic_uint *)&seg->magic, memory_order_acquire) != RT_METRICS_MAGIC ||
+        seg->version != RT_METRICS_VERSION || seg->nsvc > RT_METRICS_MAX_SVC) {
+        printf("%s is not set up, or from another version\n", RT_METRICS_NAME);
+        munmap((void *)seg, sizeof(rt_metrics_seg_t));
+        return NULL;
+    }
+
+    return seg;
+}
+
+static void draw(const rt_metrics_seg_t *seg, unsigned long long *last_busy, unsigned long long interval_ns) {
+    rt_metrics_release_t rel;
+    rt_metrics_run_t run;
+    unsigned long long backlog;
+    unsigned int i;
+
+    // Home the cursor and clear, so the table redraws in place
+    printf("\033[H\033[J");
+    printf("pid %d  up %.1f s  period %.3f ms\n\n", (int)seg->pid, rt_time_sec(rt_time_mono() - seg->start_ns),
+           seg->period_ns / 1e6);
+    printf("%-10s %10s %10s %7s %7s %10s %10s %9s %9s %9s %6s %4s\n", "service", "released", "completed",
+           "backlog", "missed", "latency us", "max lat", "jitter", "exec us", "max exec", "cpu%", "core");
+
+    for (i = 0; i < seg->nsvc; i++) {
+        rt_metrics_read_release(&seg->svc[i], &rel);
+        rt_metrics_read_run(&seg->svc[i], &run);
+
+        backlog = (rel.released > run.completed) ? rel.released - run.completed : 0;
+        printf("%-10.*s %10llu %10llu %7llu %7llu %10.1f %10.1f %9.1f %9.1f %9.1f %6.2f %4d\n",
+               RT_METRICS_NAME_LEN, seg->svc[i].name, rel.released, run.completed, backlog, rel.missed,
+               run.latency_ns / 1000.0, run.max_latency_ns / 1000.0, run.jitter_ns / 1000.0,
+               run.exec_ns / 1000.0, run.max_exec_ns / 1000.0,
+               (last_busy[i] <= run.busy_ns) ? 100.0 * (run.busy_ns - last_busy[i]) / interval_ns : 0.0,
+               run.cpu);
+        last_busy[i] = run.busy_ns;
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long long last_busy[RT_METRICS_MAX_SVC] = { 0 };
+    unsigned long long interval_ms = 1000, last, now;
+    const rt_metrics_seg_t *seg;
+    rt_metrics_run_t run;
+    struct timespec delay;
+    long refreshes = -1;
+    unsigned int i;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:n:")) != -1) {
+        switch (opt) {
+        case 'i':
+            interval_ms = strtoull(optarg, NULL, 10);
+            break;
+        case 'n':
+            refreshes = atol(optarg);
+            break;
+        default:
+            printf("Usage: %s [-i interval_ms] [-n refreshes]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (interval_ms == 0)
+        interval_ms = 1;
+
+    seg = attach();
+    if (seg == NULL)
+        return -1;
+
+    delay.tv_sec = interval_ms / 1000;
+    delay.tv_nsec = (interval_ms % 1000) * 1000000L;
+
+    // Utilization is over each interval, not since the start
+    for (i = 0; i < seg->nsvc; i++) {
+        rt_metrics_read_run(&seg->svc[i], &run);
+        last_busy[i] = run.busy_ns;
+    }
+    last = rt_time_mono();
+
+    while (refreshes != 0) {
+        nanosleep(&delay, NULL);
+        now = rt_time_mono();
+        draw(seg, last_busy, now - last);
+        last = now;
+        if (refreshes > 0)
+            refreshes--;
+
+        // The segment outlives the process only until rt_metrics_close() unlinks it
+        if (kill(seg->pid, 0) != 0 && errno == ESRCH) {
+            printf("\nsequencer exited\n");
+            break;
+        }
+    }
+
+    munmap((void *)seg, sizeof(rt_metrics_seg_t));
+    return 0;
+}
@@ -0,0 +1,367 @@
+/**
+ * File: seqd.c
+ * Author: Brad Waggle
+ * Description: Sequencer daemon that releases services running in other
+ *              processes.
+ * Date: October 18, 2026
+ */
+
+// The Sequencer() in seqgenex0.c can only release services compiled into
+// the same binary. seqd keeps the timing source in its own process and
+// lets independently built services register over a Unix-domain socket,
+// each declaring a period and phase in sequencer ticks and its priority.
+//
+// A registered client gets two descriptors over SCM_RIGHTS: an eventfd the
+// daemon posts on every release, and a memfd page (seqd_slot_t) with the
+// release time. The client library writes its release latency back into
+// that page, so the daemon reports per-client latency with no extra
+// messages. A client unregisters by closing its socket or exiting.
+//
+// The tick thread runs SCHED_FIFO at the maximum priority with absolute
+// CLOCK_MONOTONIC sleeps, and only reads the client table. Registration
+// and teardown run in the main thread at normal priority. A client is
+// published with its active flag, and on teardown its descriptors are only
+// closed after the tick thread has finished the tick that may still use them.
+//
+// Usage: seqd [tick_us] [cpu]
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "seqgen.h"
+#include "seqd.h"
+#include "rt_time.h"
+
+// One registered service process
+typedef struct
+{
+    atomic_int active;              // set last on registration, cleared first on teardown
+    char name[SEQD_NAME_LEN];
+    unsigned int period_ticks;
+    unsigned int phase_ticks;
+    int priority;
+    pid_t pid;
+    int sock;
+    int release_fd;
+    seqd_slot_t *slot;
+} seqd_client_entry_t;
+
+// How long a new connection gets to send its registration, the main loop waits that long at most
+#define SEQD_REGISTER_TIMEOUT_MS (100)
+
+static seqd_client_entry_t clients[SEQD_MAX_CLIENTS];
+static unsigned long long tick_ns = RTSEQ_DELAY_NSEC;
+static atomic_ullong ticks;         // ticks completed by the tick thread
+static atomic_int running = 1;
+static unsigned long long worst_tick_late_ns;
+
+static void post_release(seqd_client_entry_t *c) {
+    uint64_t one = 1;
+
+    atomic_store_explicit(&c->slot->release_ns, rt_time_mono(), memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->slot->releases, 1, memory_order_relaxed);
+    if (write(c->release_fd, &one, sizeof(one)) != sizeof(one))
+        perror("seqd release");
+}
+
+// SCHED_FIFO tick thread, the only timing source for every client
+static void *tick_thread(void *arg) {
+    struct timespec next;
+    unsigned long long tick, late;
+    rt_ns_t next_ns;
+    seqd_client_entry_t *c;
+    int i;
+
+    next_ns = rt_time_mono();
+
+    while (atomic_load(&running)) {
+        next_ns += tick_ns;
+        next = rt_time_to_ts(next_ns);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR)
+            ;
+
+        late = rt_time_mono() - next_ns;
+        if (late > worst_tick_late_ns)
+            worst_tick_late_ns = late;
+
+        // Phases are on the daemon's tick count, so clients share one time line
+        tick = atomic_load(&ticks);
+        for (i = 0; i < SEQD_MAX_CLIENTS; i++) {
+            c = &clients[i];
+            if (atomic_load(&c->active) && (tick % c->period_ticks) == c->phase_ticks)
+                post_release(c);
+        }
+
+        atomic_store(&ticks, tick + 1);
+    }
+
+    return NULL;
+}
+
+static void report_client(seqd_client_entry_t *c) {
+    seqd_slot_t *s = c->slot;
+    unsigned long long wakeups = atomic_load(&s->wakeups), taken = atomic_load(&s->taken);
+
+    printf("  %-16s pid=%-6d T=%-4u phase=%-4u prio=%-3d released=%llu taken=%llu coalesced=%llu latency avg=%.1f max=%.1f us\n",
+           c->name, (int)c->pid, c->period_ticks, c->phase_ticks, c->priority,
+           atomic_load(&s->releases), taken, taken - wakeups,
+           wakeups ? atomic_load(&s->latency_sum_ns) / (wakeups * 1000.0) : 0.0,
+           atomic_load(&s->latency_max_ns) / 1000.0);
+}
+
+// Validate a registration and set the client up, returns 0 or an errno value
+static int add_client(int sock, seqd_register_t *req, int *client_id, int *memfd) {
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    seqd_client_entry_t *c = NULL;
+    int i, fd, err;
+
+    if (req->period_ticks == 0 || req->phase_ticks >= req->period_ticks)
+        return EINVAL;
+    if (req->priority < sched_get_priority_min(SCHED_FIFO) || req->priority >= sched_get_priority_max(SCHED_FIFO))
+        return ERANGE;              // the tick thread must stay above every client
+
+    for (i = 0; i < SEQD_MAX_CLIENTS && c == NULL; i++)
+        if (!atomic_load(&clients[i].active) && clients[i].sock < 0)
+            c = &clients[i];
+    if (c == NULL)
+        return ENOSPC;
+
+    // errno is saved before the clean-up can change it
+    fd = memfd_create(req->name, MFD_CLOEXEC);
+    if (fd < 0 || ftruncate(fd, sizeof(seqd_slot_t)) != 0) {
+        err = errno;
+        if (fd >= 0) close(fd);
+        return err;
+    }
+    c->slot = mmap(NULL, sizeof(seqd_slot_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (c->slot == MAP_FAILED) {
+        err = errno;
+        close(fd);
+        return err;
+    }
+    mlock(c->slot, sizeof(seqd_slot_t));
+
+    c->release_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (c->release_fd < 0) {
+        err = errno;
+        munmap(c->slot, sizeof(seqd_slot_t));
+        close(fd);
+        return err;
+    }
+
+    memcpy(c->name, req->name, SEQD_NAME_LEN);
+    c->name[SEQD_NAME_LEN - 1] = '\0';
+    c->period_ticks = req->period_ticks;
+    c->phase_ticks = req->phase_ticks;
+    c->priority = req->priority;
+    c->pid = (getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0) ? cred.pid : -1;
+    c->sock = sock;
+
+    *client_id = c - clients;
+    *memfd = fd;
+    atomic_store(&c->active, 1);
+
+    return 0;
+}
+
+// Drop a client once the tick thread can no longer be using it
+static void remove_client(seqd_client_entry_t *c) {
+    unsigned long long tick;
+
+    atomic_store(&c->active, 0);
+    tick = atomic_load(&ticks);
+    while (atomic_load(&running) && atomic_load(&ticks) == tick)
+        usleep(tick_ns / 1000);
+
+    printf("seqd: %s unregistered\n", c->name);
+    report_client(c);
+
+    munmap(c->slot, sizeof(seqd_slot_t));
+    close(c->release_fd);
+    close(c->sock);
+    c->sock = -1;
+}
+
+// Read a registration from a new connection and reply, with descriptors on success
+static void accept_client(int listen_sock) {
+    char control[CMSG_SPACE(2 * sizeof(int))] = { 0 };
+    seqd_register_t req;
+    seqd_reply_t reply = { 0 };
+    struct iovec iov = { .iov_base = &reply, .iov_len = sizeof(reply) };
+    struct timeval timeout = { 0, SEQD_REGISTER_TIMEOUT_MS * 1000 };
+    struct msghdr msg = { 0 };
+    struct cmsghdr *cmsg;
+    int sock, memfd = -1, fds[2];
+    ssize_t got;
+
+    sock = accept4(listen_sock, NULL, NULL, SOCK_CLOEXEC);
+    if (sock < 0) {
+        perror("seqd accept");
+        return;
+    }
+
+    // A client that connects and stays silent must not hold up every other registration
+    if (setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0)
+        perror("seqd SO_RCVTIMEO");
+
+    got = recv(sock, &req, sizeof(req), 0);
+    if (got != sizeof(req))
+        reply.status = (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) ? ETIMEDOUT : EPROTO;
+    else
+        reply.status = add_client(sock, &req, &reply.client_id, &memfd);
+    reply.tick_ns = tick_ns;
+
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (reply.status == 0) {
+        fds[0] = clients[reply.client_id].release_fd;
+        fds[1] = memfd;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(2 * sizeof(int));
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    }
+
+    if (sendmsg(sock, &msg, MSG_NOSIGNAL) != sizeof(reply))
+        perror("seqd reply");
+
+    if (memfd >= 0)
+        close(memfd);
+
+    if (reply.status == 0) {
+        req.name[SEQD_NAME_LEN - 1] = '\0';
+        printf("seqd: %s registered as client %d, T=%u phase=%u prio=%d\n",
+               req.name, reply.client_id, req.period_ticks, req.phase_ticks, req.priority);
+    } else {
+        printf("seqd: registration refused: %s\n", strerror(reply.status));
+        close(sock);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    struct pollfd pfds[SEQD_MAX_CLIENTS + 2];
+    int owner[SEQD_MAX_CLIENTS + 2];
+    struct sched_param param;
+    pthread_attr_t attr;
+    pthread_t tick_tid;
+    cpu_set_t cpuset;
+    sigset_t sigs;
+    int listen_sock, sig_fd, nfds, i, cpu = -1;
+
+    if (argc > 1) tick_ns = strtoull(argv[1], NULL, 10) * 1000ULL;
+    if (argc > 2) cpu = atoi(argv[2]);
+    if (tick_ns == 0) {
+        printf("tick must be at least 1 us\n");
+        return -1;
+    }
+
+    for (i = 0; i < SEQD_MAX_CLIENTS; i++)
+        clients[i].sock = -1;
+
+    // SIGINT and SIGTERM are read from a signalfd, the tick thread inherits the mask
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGINT);
+    sigaddset(&sigs, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &sigs, NULL);
+    sig_fd = signalfd(-1, &sigs, SFD_CLOEXEC);
+
+    listen_sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    strncpy(addr.sun_path, SEQD_SOCKET_PATH, sizeof(addr.sun_path) - 1);
+    unlink(SEQD_SOCKET_PATH);
+    if (listen_sock < 0 || bind(listen_sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(listen_sock, SEQD_MAX_CLIENTS) != 0) {
+        perror("seqd listen");
+        return -1;
+    }
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        perror("seqd mlockall");
+
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+    pthread_attr_setschedparam(&attr, &param);
+    if (cpu >= 0) {
+        CPU_ZERO(&cpuset);
+        CPU_SET(cpu, &cpuset);
+        pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuset);
+    }
+    if (pthread_create(&tick_tid, &attr, tick_thread, NULL) != 0) {
+        printf("No RT privilege, tick thread runs SCHED_OTHER\n");
+        pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+        if (pthread_create(&tick_tid, &attr, tick_thread, NULL) != 0) {
+            printf("pthread_create for tick thread failed\n");
+            return -1;
+        }
+    }
+
+    printf("seqd: listening on %s, tick %.3f ms\n", SEQD_SOCKET_PATH, tick_ns / 1000000.0);
+
+    while (atomic_load(&running)) {
+        // The socket of every registered client is watched for hang-up
+        nfds = 0;
+        pfds[nfds].fd = sig_fd; pfds[nfds].events = POLLIN; owner[nfds++] = -1;
+        pfds[nfds].fd = listen_sock; pfds[nfds].events = POLLIN; owner[nfds++] = -1;
+        for (i = 0; i < SEQD_MAX_CLIENTS; i++) {
+            if (clients[i].sock >= 0) {
+                pfds[nfds].fd = clients[i].sock;
+                pfds[nfds].events = POLLIN;
+                owner[nfds++] = i;
+            }
+        }
+
+        if (poll(pfds, nfds, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("seqd poll");
+            break;
+        }
+
+        if (pfds[0].revents & POLLIN)
+            atomic_store(&running, 0);
+        if (pfds[1].revents & POLLIN)
+            accept_client(listen_sock);
+        for (i = 2; i < nfds; i++)
+            if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR))
+                remove_client(&clients[owner[i]]);
+    }
+
+    pthread_join(tick_tid, NULL);
+
+    printf("seqd: %llu ticks, worst tick lateness %.1f us\n", atomic_load(&ticks), worst_tick_late_ns / 1000.0);
+    for (i = 0; i < SEQD_MAX_CLIENTS; i++) {
+        if (clients[i].sock >= 0) {
+            report_client(&clients[i]);
+            munmap(clients[i].slot, sizeof(seqd_slot_t));
+            close(clients[i].release_fd);
+            close(clients[i].sock);
+        }
+    }
+
+    close(listen_sock);
+    unlink(SEQD_SOCKET_PATH);
+
+    return 0;
+}
@@ -0,0 +1,43 @@
+#ifndef SEQD_H
+#define SEQD_H
+
+#include <stdatomic.h>
+
+// Wire protocol between the sequencer daemon (seqd.c) and its clients (seqd_client.c)
+
+#define SEQD_SOCKET_PATH "/tmp/seqd.sock"
+#define SEQD_MAX_CLIENTS (16)
+#define SEQD_NAME_LEN (32)
+
+// Sent once by a client after it connects
+typedef struct
+{
+    char name[SEQD_NAME_LEN];
+    unsigned int period_ticks;      // released every period_ticks sequencer ticks
+    unsigned int phase_ticks;       // first release at this tick, must be below the period
+    int priority;                   // SCHED_FIFO priority the client runs at
+} seqd_register_t;
+
+// Reply to a registration. On success it carries two descriptors with
+// SCM_RIGHTS: the release eventfd and a memfd holding the client's seqd_slot_t.
+typedef struct
+{
+    int status;                     // 0, or an errno value for the refusal
+    int client_id;
+    unsigned long long tick_ns;     // sequencer tick, period and phase are in these
+} seqd_reply_t;
+
+// Per-client page shared by the daemon and the client. The daemon writes the
+// release fields, the client writes the latency fields, nobody locks.
+typedef struct
+{
+    atomic_ullong releases;         // posted by the daemon
+    atomic_ullong release_ns;       // CLOCK_MONOTONIC time of the latest release
+
+    _Alignas(64) atomic_ullong wakeups;     // releases taken by the client, batched or not
+    atomic_ullong taken;                    // releases taken including coalesced ones
+    atomic_ullong latency_sum_ns;           // latest release to the client running
+    atomic_ullong latency_max_ns;
+} seqd_slot_t;
+
+#endif
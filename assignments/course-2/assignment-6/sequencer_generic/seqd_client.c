@@ -0,0 +1,186 @@
+/**
+ * File: seqd_client.c
+ * Author: Brad Waggle
+ * Description: Client library for services that take their releases from
+ *              the sequencer daemon.
+ * Date: October 18, 2026
+ */
+
+// seqd_register() sets the caller to its SCHED_FIFO priority, connects to
+// the daemon, declares period, phase and priority, and receives a release
+// eventfd and the shared slot page. From then on the client waits with
+// seqd_wait(), or adds seqd_release_fd() to its own epoll set and calls
+// seqd_consume() when it is readable, like an rt_release in-process.
+//
+// Each time the client takes releases it records the latency from the
+// latest release to that point in the slot, where the daemon reads it.
+// The connection stays open, closing it or exiting unregisters.
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "seqd_client.h"
+#include "rt_time.h"
+
+// Receive the reply and the two descriptors that come with it
+static int recv_reply(int sock, seqd_reply_t *reply, int fds[2]) {
+    char control[CMSG_SPACE(2 * sizeof(int))];
+    struct iovec iov = { .iov_base = reply, .iov_len = sizeof(*reply) };
+    struct msghdr msg = { 0 };
+    struct cmsghdr *cmsg;
+
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) != sizeof(*reply)) {
+        perror("seqd recvmsg");
+        return -1;
+    }
+    if (reply->status != 0)
+        return 0;
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == NULL || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(2 * sizeof(int))) {
+        printf("seqd reply without descriptors\n");
+        return -1;
+    }
+    memcpy(fds, CMSG_DATA(cmsg), 2 * sizeof(int));
+
+    return 0;
+}
+
+int seqd_register(seqd_client_t *client, const char *path, const char *name,
+                  unsigned int period_ticks, unsigned int phase_ticks, int priority) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    struct sched_param param = { .sched_priority = priority };
+    seqd_register_t req = { 0 };
+    seqd_reply_t reply;
+    int fds[2];
+
+    memset(client, 0, sizeof(*client));
+    client->release_fd = -1;
+
+    if (sched_setscheduler(0, SCHED_FIFO, &param) != 0)
+        perror("seqd client SCHED_FIFO");
+
+    client->sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (client->sock < 0) {
+        perror("seqd socket");
+        return -1;
+    }
+
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    if (connect(client->sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        perror("seqd connect");
+        close(client->sock);
+        return -1;
+    }
+
+    strncpy(req.name, name, SEQD_NAME_LEN - 1);
+    req.period_ticks = period_ticks;
+    req.phase_ticks = phase_ticks;
+    req.priority = priority;
+    if (send(client->sock, &req, sizeof(req), 0) != sizeof(req)) {
+        perror("seqd send");
+        close(client->sock);
+        return -1;
+    }
+
+    if (recv_reply(client->sock, &reply, fds) != 0) {
+        close(client->sock);
+        return -1;
+    }
+    if (reply.status != 0) {
+        printf("seqd refused %s: %s\n", name, strerror(reply.status));
+        close(client->sock);
+        return -1;
+    }
+
+    client->slot = mmap(NULL, sizeof(seqd_slot_t), PROT_READ | PROT_WRITE, MAP_SHARED, fds[1], 0);
+    close(fds[1]);
+    if (client->slot == MAP_FAILED) {
+        perror("seqd mmap slot");
+        close(fds[0]);
+        close(client->sock);
+        return -1;
+    }
+    mlock(client->slot, sizeof(seqd_slot_t));
+
+    client->release_fd = fds[0];
+    client->client_id = reply.client_id;
+    client->tick_ns = reply.tick_ns;
+
+    return 0;
+}
+
+// Descriptor to add to the client's epoll set with EPOLLIN
+int seqd_release_fd(seqd_client_t *client) {
+    return client->release_fd;
+}
+
+// Take all pending releases and record the latency, 0 if none were pending
+unsigned long long seqd_consume(seqd_client_t *client) {
+    seqd_slot_t *slot = client->slot;
+    unsigned long long released, now, latency;
+    uint64_t count;
+
+    if (read(client->release_fd, &count, sizeof(count)) != sizeof(count))
+        return 0;
+
+    // A newer release can land between the read and here, never count that as negative
+    released = atomic_load_explicit(&slot->release_ns, memory_order_relaxed);
+    now = rt_time_mono();
+    latency = (now > released) ? now - released : 0;
+    atomic_fetch_add_explicit(&slot->wakeups, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&slot->taken, count, memory_order_relaxed);
+    atomic_fetch_add_explicit(&slot->latency_sum_ns, latency, memory_order_relaxed);
+    if (latency > atomic_load_explicit(&slot->latency_max_ns, memory_order_relaxed))
+        atomic_store_explicit(&slot->latency_max_ns, latency, memory_order_relaxed);
+
+    return count;
+}
+
+// Block until released, returns the number of releases taken, 0 if the daemon went away
+unsigned long long seqd_wait(seqd_client_t *client) {
+    struct pollfd pfd[2] = {
+        { .fd = client->release_fd, .events = POLLIN },
+        { .fd = client->sock, .events = POLLIN },
+    };
+    unsigned long long count;
+
+    while ((count = seqd_consume(client)) == 0) {
+        if (poll(pfd, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("seqd wait");
+            return 0;
+        }
+        // The daemon never sends after the reply, so the socket is only readable on hang-up
+        if (!(pfd[0].revents & POLLIN) && (pfd[1].revents & (POLLIN | POLLHUP)))
+            return 0;
+    }
+
+    return count;
+}
+
+void seqd_unregister(seqd_client_t *client) {
+    if (client->slot != NULL)
+        munmap(client->slot, sizeof(seqd_slot_t));
+    if (client->release_fd >= 0)
+        close(client->release_fd);
+    close(client->sock);
+    client->slot = NULL;
+    client->release_fd = -1;
+}
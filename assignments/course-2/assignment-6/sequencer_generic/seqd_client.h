@@ -0,0 +1,23 @@
+#ifndef SEQD_CLIENT_H
+#define SEQD_CLIENT_H
+
+#include "seqd.h"
+
+// A service process registered with the sequencer daemon
+typedef struct
+{
+    int sock;                       // kept open, the daemon drops the client when it closes
+    int release_fd;                 // eventfd posted by the daemon on every release
+    seqd_slot_t *slot;              // shared release and latency page
+    int client_id;
+    unsigned long long tick_ns;
+} seqd_client_t;
+
+int seqd_register(seqd_client_t *client, const char *path, const char *name,
+                  unsigned int period_ticks, unsigned int phase_ticks, int priority);
+int seqd_release_fd(seqd_client_t *client);
+unsigned long long seqd_consume(seqd_client_t *client);
+unsigned long long seqd_wait(seqd_client_t *client);
+void seqd_unregister(seqd_client_t *client);
+
+#endif
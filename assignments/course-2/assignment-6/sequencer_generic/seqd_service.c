@@ -0,0 +1,55 @@
+/**
+ * File: seqd_service.c
+ * Author: Brad Waggle
+ * Description: Example service process released by the sequencer daemon.
+ * Date: October 18, 2026
+ */
+
+// Registers with seqd, takes the given number of releases and logs each
+// one to syslog like the in-process services do, then unregisters. Several
+// can run at once with different periods, phases and priorities.
+//
+// Usage: seqd_service name period_ticks phase_ticks priority [releases]
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <syslog.h>
+#include <sys/mman.h>
+#include "seqd_client.h"
+
+int main(int argc, char *argv[])
+{
+    seqd_client_t client;
+    unsigned long long count, taken = 0, limit, wakeups;
+
+    if (argc < 5) {
+        printf("Usage: %s name period_ticks phase_ticks priority [releases]\n", argv[0]);
+        return -1;
+    }
+    limit = (argc > 5) ? strtoull(argv[5], NULL, 10) : 100;
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        perror("mlockall");
+
+    if (seqd_register(&client, SEQD_SOCKET_PATH, argv[1], atoi(argv[2]), atoi(argv[3]), atoi(argv[4])))
+        return -1;
+
+    printf("%s: client %d, tick %.3f ms\n", argv[1], client.client_id, client.tick_ns / 1000000.0);
+
+    while (taken < limit && (count = seqd_wait(&client)) > 0) {
+        taken += count;
+        syslog(LOG_CRIT, "%s: release %llu on core %d\n", argv[1], taken, sched_getcpu());
+    }
+
+    wakeups = atomic_load(&client.slot->wakeups);
+    printf("%s: %llu releases, %llu wake-ups, latency avg=%.1f max=%.1f us\n", argv[1], taken, wakeups,
+           wakeups ? atomic_load(&client.slot->latency_sum_ns) / (wakeups * 1000.0) : 0.0,
+           atomic_load(&client.slot->latency_max_ns) / 1000.0);
+
+    seqd_unregister(&client);
+
+    return 0;
+}
@@ -1,5 +1,7 @@
 #ifndef _SEQGEN_
 
+#include "rt_time.h"
+
 #define USEC_PER_MSEC (1000)
 #define MSEC_PER_SEC (1000)
 #define NANOSEC_PER_SEC (1000000000)
@@ -30,7 +32,7 @@ typedef struct
 } threadParams_t;
 
 
-double getTimeMsec(void);
+rt_ns_t getTimeNsec(void);
 void print_scheduler(void);
 void get_cpu_core_config(void);
 
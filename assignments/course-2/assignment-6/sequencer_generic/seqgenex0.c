@@ -48,19 +48,35 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <pthread.h>
 #include <sched.h>
 #include <time.h>
 #include <semaphore.h>
+#include <stdatomic.h>
 
 #include <syslog.h>
 #include <sys/time.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
 #include "seqgen.h"
+#include "rt_time.h"
 #include <sys/sysinfo.h>
 #include <sys_logger.h>
+#include "frame_ring.h"
+#include "offload_pool.h"
+#include "rt_sched.h"
+#include "mailbox.h"
+#include "rt_release.h"
+#include "trace_ring.h"
+#include "rt_pool.h"
+#include "svc_stats.h"
+#include "svc_warmup.h"
+#include "hdr_hist.h"
+#include "rt_metrics.h"
 
 // Course attribtues
 #define COURSE 2        // course number
@@ -68,12 +84,35 @@
 
 #define ABS_DELAY  // Flag for absolute delay
 #define DRIFT_CONTROL // Flag for drift control
+#define SERVICE_WARMUP // Flag for warming each service up before its first release
 #define NUM_THREADS (4+1) // Number of threads
 
+// Frame geometry for the acquisition ring (8-bit grayscale)
+#define FRAME_WIDTH 320
+#define FRAME_HEIGHT 240
+#define FRAME_SIZE (FRAME_WIDTH * FRAME_HEIGHT)
+
+// Control messages to an event loop service, one byte each
+#define SERVICE_CTRL_STOP 'q' // Leave the event loop
+#define SERVICE_MAX_EVENTS 4 // Events taken per epoll wake-up
+
+// Latency histograms go to the run log this often while running, and once more at the end
+#define HIST_DUMP_PERIOD_S 10 // Seconds between dumps
+#define HIST_DUMP_CYCLES (HIST_DUMP_PERIOD_S * (NANOSEC_PER_SEC / RTSEQ_DELAY_NSEC)) // Sequencer cycles between dumps
+
+// Execution budgets, a release over its budget is traced as a budget overrun
+#define BUDGET_PCT 50 // Share of its period a service may execute for
+#define SVC_BUDGET_NS(periods) ((unsigned long long)(periods) * RTSEQ_DELAY_NSEC * BUDGET_PCT / 100) // Budget of a service released every periods cycles
+
 int abortTest=FALSE; // When true, aborts Service
-int abortS1=FALSE, abortS2=FALSE, abortS3=FALSE, abortS4=FALSE; // When true, aborts Service
-sem_t semS1, semS2, semS3, semS4; // Service semaphores
-static double start_time = 0; // Start time
+int abortS1=FALSE, abortS2=FALSE, abortS3=FALSE; // When true, aborts Service
+sem_t semS1, semS2, semS3; // Service semaphores
+rt_release_t releaseS4; // Service_4 release as an eventfd for its epoll loop
+int controlS4[2] = {-1, -1}; // Control messages to Service_4, read end first
+atomic_ulong svc_done[NUM_THREADS]; // Releases each service has completed, checked at its next release
+atomic_ulong svc_released[NUM_THREADS]; // Releases posted to each service, a service stops only once all are done
+atomic_ullong svc_release_ns[NUM_THREADS]; // CLOCK_MONOTONIC time of each service's latest release
+static rt_ns_t start_time = 0; // CLOCK_REALTIME time the run started, in ns
 
 pthread_t threads[NUM_THREADS]; // Thread array
 pthread_attr_t rt_sched_attr[NUM_THREADS]; // Thread scheduling attributes
@@ -82,20 +121,82 @@ int rt_max_prio, rt_min_prio; // Max in Min priority
 struct sched_param rt_param[NUM_THREADS]; // Store scheduling parameters
 threadParams_t threadParams[NUM_THREADS]; // Store thread parameters
 
+frame_ring_t frame_ring; // Frames shared by acquisition (S1) and processing (S2-S4)
+int stage_timestamp, stage_difference, stage_save; // Frame ring consumer stages
+
+offload_pool_t offload_pool; // SCHED_OTHER workers that do I/O for best-effort services
+int frames_fd = -1; // File the save service writes frames to
+
+// Latest time-stamp from the timestamp service (S2)
+typedef struct
+{
+    unsigned long long frame_seq; // Frame last time-stamped by S2
+    struct timespec frame_time; // Its acquisition time
+} frame_stamp_t;
+
+// Analysis results the save service (S4) stores with a frame
+typedef struct
+{
+    unsigned long long frame_seq; // Frame last time-stamped by S2
+    struct timespec frame_time; // Its acquisition time
+    unsigned long diff_sum; // Last difference result from S3
+} frame_info_t;
+
+// Latest-value results, each has one writer and the save service reads both without locking
+mailbox_t timestamp_mb; // frame_stamp_t written by S2
+mailbox_t difference_mb; // diff_sum written by S3
+
+// Message from the save service (S4) to the offload worker that writes the frame
+typedef struct
+{
+    frame_slot_t *frame; // Frame to save, released by the worker
+    frame_info_t info; // Time-stamp and difference result saved with it
+} save_job_t;
+
+rt_pool_t save_job_pool; // One save_job_t per queued save, never malloc'd
+rt_arena_t diff_arena; // Per-release scratch for the difference image (S3)
+
+svc_stats_t svc_stats[NUM_THREADS]; // Per-release interference accounting, [0] is the sequencer
+
+// Log every service's latency histograms, run by an offload worker every HIST_DUMP_PERIOD_S
+static void hist_dump_job(void *arg)
+{
+    hdr_hist_t *hists[3];
+    char line[200], msg[256];
+    int i, j;
+
+    for (i = 0; i < NUM_THREADS; i++) {
+        hists[0] = &svc_stats[i].latency_hist;
+        hists[1] = &svc_stats[i].response_hist;
+        hists[2] = &svc_stats[i].exec_hist;
+        for (j = 0; j < 3; j++) {
+            hdr_hist_format(hists[j], line, sizeof(line));
+            snprintf(msg, sizeof(msg), "%s %s", svc_stats[i].name, line);
+            log_sys(msg, COURSE, ASSIGNMENT);
+        }
+    }
+}
 
 void main(void)
 {
-    double current_time; // Variable to hold current time
+    rt_ns_t current_time; // Variable to hold current time
     struct timespec rt_res, monotonic_res; // Structs to hold resolution of different clocks
     int i, rc, cpuidx; // Integer variables for loop, return codes, CPU index
     cpu_set_t threadcpu; // CPU set for thread affinity
     struct sched_param main_param; // Scheduler parameters for main thread
     pid_t mainpid; // Process ID of the main thread
+    char frames_path[64]; // Name of the saved frames file
+    char trace_path[64]; // Name of the binary trace file
 
-    clear_syslog(); // Clear the system log
-    log_uname(COURSE, ASSIGNMENT); // Log machine information with course and assignment details
+    // This run's own log file, its header has the machine, CPU and clock details
+#ifdef COMPACT_LOG
+    // Written in the compact binary form, clogcat prints it as text
+    if (log_run_open_compact(COURSE, ASSIGNMENT)) printf("No run log, log_sys goes to syslog\n");
+#else
+    if (log_run_open(COURSE, ASSIGNMENT)) printf("No run log, log_sys goes to syslog\n");
+#endif
 
-    start_time = getTimeMsec(); // Record the start time in milliseconds
+    start_time = getTimeNsec(); // Record the start time in nanoseconds
 
     usleep(1000000); // Delay the start for a second
 
@@ -111,7 +212,18 @@ void main(void)
     if (sem_init(&semS1, 0, 0)) { printf("Failed to initialize S1 semaphore\n"); exit(-1); }
     if (sem_init(&semS2, 0, 0)) { printf("Failed to initialize S2 semaphore\n"); exit(-1); }
     if (sem_init(&semS3, 0, 0)) { printf("Failed to initialize S3 semaphore\n"); exit(-1); }
-    if (sem_init(&semS4, 0, 0)) { printf("Failed to initialize S4 semaphore\n"); exit(-1); }
+    if (rt_release_init(&releaseS4, "S4")) { printf("Failed to initialize S4 release\n"); exit(-1); }
+    if (pipe2(controlS4, O_CLOEXEC)) { printf("Failed to initialize S4 control pipe\n"); exit(-1); }
+
+    // Preallocate the frame ring and register its consumers before any service runs
+    if (frame_ring_init(&frame_ring, FRAME_SIZE)) { printf("Failed to initialize frame ring\n"); exit(-1); }
+    stage_timestamp = frame_ring_add_stage(&frame_ring, "timestamp");
+    stage_difference = frame_ring_add_stage(&frame_ring, "difference");
+    stage_save = frame_ring_add_stage(&frame_ring, "save");
+
+    // Reserve and prefault everything the services allocate while running
+    if (rt_pool_init(&save_job_pool, "save_job", sizeof(save_job_t), OFFLOAD_QUEUE_DEPTH)) { printf("Failed to initialize save job pool\n"); exit(-1); }
+    if (rt_arena_init(&diff_arena, "difference", FRAME_SIZE)) { printf("Failed to initialize difference arena\n"); exit(-1); }
 
     mainpid = getpid(); // Get the process ID of the main thread
 
@@ -128,6 +240,29 @@ void main(void)
     printf("rt_max_prio=%d\n", rt_max_prio); // Print maximum priority
     printf("rt_min_prio=%d\n", rt_min_prio); // Print minimum priority
 
+    // Interference accounting for the sequencer and each service
+    svc_stats_init(&svc_stats[0], "Sequencer");
+    svc_stats_init(&svc_stats[1], "S1");
+    svc_stats_init(&svc_stats[2], "S2");
+    svc_stats_init(&svc_stats[3], "S3");
+    svc_stats_init(&svc_stats[4], "S4");
+
+    // Live counters for rtstat, the RT threads only store to it
+    if (rt_metrics_open(NUM_THREADS, RTSEQ_DELAY_NSEC)) printf("No live metrics segment, rtstat will not attach\n");
+    for (i = 0; i < NUM_THREADS; i++) rt_metrics_name(i, svc_stats[i].name);
+
+    // Timing model for the response time analysis, the sequencer interferes with every service.
+    // Service periods are the sequencer release divisors below.
+    rt_service_register(0, "Sequencer", rt_max_prio, RTSEQ_DELAY_NSEC);
+    rt_service_register(1, "S1", rt_max_prio - 1, 2 * RTSEQ_DELAY_NSEC);
+    rt_service_register(2, "S2", rt_max_prio - 2, 5 * RTSEQ_DELAY_NSEC);
+    rt_service_register(3, "S3", rt_max_prio - 3, 7 * RTSEQ_DELAY_NSEC);
+    rt_service_register(4, "S4", rt_max_prio - 4, 13 * RTSEQ_DELAY_NSEC);
+
+    // Results shared between services go through mailboxes, so no service blocks on another
+    if (mailbox_init(&timestamp_mb, "timestamp", sizeof(frame_stamp_t))) { printf("Failed to initialize timestamp mailbox\n"); exit(-1); }
+    if (mailbox_init(&difference_mb, "difference", sizeof(unsigned long))) { printf("Failed to initialize difference mailbox\n"); exit(-1); }
+
     // Set up attributes and parameters for multiple threads
     for (i = 0; i < NUM_THREADS; i++) {
         CPU_ZERO(&threadcpu); // Clear the CPU set
@@ -147,7 +282,30 @@ void main(void)
 
     printf("Service threads will run on %d CPU cores\n", CPU_COUNT(&threadcpu)); // Print the number of CPU cores threads will run on
 
-    current_time = getTimeMsec(); // Get current time in milliseconds
+    // Best-effort I/O runs on the cores the RT services are not pinned to
+    snprintf(frames_path, sizeof(frames_path), "frames-%d.%d.pgm", COURSE, ASSIGNMENT);
+    frames_fd = open(frames_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (frames_fd < 0) perror("open frames file");
+    if (offload_pool_start(&offload_pool, 1, &threadcpu)) { printf("Failed to start offload pool\n"); exit(-1); }
+
+#ifdef FLIGHT_RECORDER
+    // Services log releases to overwriting rings, only written out around a miss or overrun
+    snprintf(trace_path, sizeof(trace_path), "flight-%d.%d", COURSE, ASSIGNMENT);
+    if (trace_flight_start(trace_path, RTSEQ_DELAY_NSEC, &threadcpu)) { printf("Failed to start flight recorder\n"); exit(-1); }
+#else
+    // Services log releases to per-thread trace rings, drained to a file off the RT cores
+    snprintf(trace_path, sizeof(trace_path), "trace-%d.%d.bin", COURSE, ASSIGNMENT);
+    if (trace_start(trace_path, RTSEQ_DELAY_NSEC, &threadcpu)) { printf("Failed to start trace\n"); exit(-1); }
+#endif
+#ifdef FTRACE_MARKERS
+    // Mirror release events to ftrace, to line them up with sched_switch (see marker_latency.c)
+    if (trace_marker_open()) printf("No trace_marker, ftrace markers off\n");
+#endif
+
+    // From here log_sys only queues, a writer off the RT cores sends batches to syslog
+    if (log_sys_start(&threadcpu, LOG_OVERFLOW_DROP)) printf("log_sys stays synchronous\n");
+
+    current_time = getTimeNsec(); // Get current time in nanoseconds since the start
 
     // Create service threads with different priorities and frequencies
     // Service_1 = Period 2
@@ -193,8 +351,38 @@ void main(void)
     for (i = 0; i < NUM_THREADS; i++)
         pthread_join(threads[i], NULL); // Wait for each thread to complete before proceeding
 
-    // Copy the updated syslog to the current project directory
-    copy_syslog(COURSE, ASSIGNMENT); // Copy syslog to the current project directory
+    trace_stop(); // Write out the rest of the trace rings
+    trace_report(); // Print records written and dropped per thread
+
+    rt_release_report(&releaseS4); // Print releases taken and coalesced by the event loop
+    rt_release_destroy(&releaseS4);
+    close(controlS4[0]);
+    close(controlS4[1]);
+
+    offload_pool_stop(&offload_pool); // Finish queued saves, which also releases their frames
+    offload_pool_report(&offload_pool); // Print submitted, completed and dropped jobs
+    if (frames_fd >= 0) close(frames_fd);
+
+    frame_ring_report(&frame_ring); // Print frame production, overruns and per-stage lag
+    rt_pool_report(&save_job_pool); // Print pool and arena high-water marks
+    rt_arena_report(&diff_arena);
+    rt_pool_destroy(&save_job_pool);
+    rt_arena_destroy(&diff_arena);
+
+    svc_stats_report(svc_stats, NUM_THREADS); // Print switches, faults, migrations and cold release penalty
+    svc_stats_report_hist(svc_stats, NUM_THREADS); // Print latency, response and execution time percentiles
+    hist_dump_job(NULL); // And log the final histograms to the run log after the periodic dumps
+    mailbox_report(&timestamp_mb); // Print writes and torn reads on the shared results
+    mailbox_report(&difference_mb);
+    rt_sched_analysis(); // Response time analysis using measured C, the sequencer included
+    frame_ring_destroy(&frame_ring); // Release the frame store
+
+    rt_metrics_close(); // Remove the live metrics segment, an attached rtstat keeps the last numbers
+    log_sys_stop(); // Write what is still queued before the run log is closed
+    log_sys_report(); // Print messages sent, dropped and batched
+
+    // Trim and close the run log in the current project directory
+    log_run_close();
 
     printf("\nTEST COMPLETE\n"); // Print message indicating completion of the test
 
@@ -205,23 +393,37 @@ void *Sequencer(void *threadp) {
     struct timespec delay_time = {0, RTSEQ_DELAY_NSEC};
     // Declare and initialize a structure for standard delaying time
     struct timespec std_delay_time = {0, RTSEQ_DELAY_NSEC};
-    // Declare and initialize a structure for the current time value
-    struct timespec current_time_val = {0, 0};
 
     // Declare structures and variables for time
     struct timespec remaining_time;
-    double current_time, last_time, scaleDelay;
-    double delta_t = (RTSEQ_DELAY_NSEC / (double)NANOSEC_PER_SEC);
-    double scale_dt;
+    rt_ns_t current_time, last_time;
+    rt_ns_t delta_t = RTSEQ_DELAY_NSEC;
+    rt_ns_t scale_dt;
+    // Time since the start for the release log lines, as seconds and microseconds
+    long long run_sec, run_usec;
     int rc, delay_cnt = 0;
+    // How late the sequencer woke against its absolute release time
+    long long wake_late_ns = 0;
+    // How far the cycle ran past its period
+    long long over_ns;
+    // Whether the service's previous release missed its deadline
+    int missed;
+    // Accounting of the cycle just finished
+    const svc_release_t *rel;
     unsigned long long seqCnt = 0;
     // Declare a pointer to threadParams_t and assign the input threadp to it
     threadParams_t *threadParams = (threadParams_t *)threadp;
-    // Declare a character array 'msg' for syslog message with a size of 512
-    char msg[512];
+    // Control message for event loop services
+    char ctrl;
+
+    // No heap allocation from here on, trapped when built with RT_MALLOC_GUARD
+    rt_pool_mark_rt_thread();
+
+    // Take a trace ring for release events
+    trace_thread_init("Sequencer");
 
-    // Get the current time in milliseconds and assign it to current_time
-    current_time = getTimeMsec();
+    // Get the current time in nanoseconds and assign it to current_time
+    current_time = getTimeNsec();
     // Set last_time to the current_time minus delta_t
     last_time = current_time - delta_t;
 
@@ -229,8 +431,8 @@ void *Sequencer(void *threadp) {
 
     // Start a do-while loop
     do {
-        // Update the current time with the current time in milliseconds
-        current_time = getTimeMsec();
+        // Update the current time with the current time in nanoseconds
+        current_time = getTimeNsec();
         // Reset delay count
         delay_cnt = 0;
 
@@ -239,7 +441,7 @@ void *Sequencer(void *threadp) {
         // Calculate scale_dt based on time differences
         scale_dt = (current_time - last_time) - delta_t;
         // Adjust delay_time based on scale_dt, uncertainties, and CLOCK_BIAS_NANOSEC
-        delay_time.tv_nsec = std_delay_time.tv_nsec - (scale_dt * (NANOSEC_PER_SEC + DT_SCALING_UNCERTAINTY_NANOSEC)) - CLOCK_BIAS_NANOSEC;
+        delay_time.tv_nsec = std_delay_time.tv_nsec - (scale_dt + scale_dt * DT_SCALING_UNCERTAINTY_NANOSEC / NANOSEC_PER_SEC) - CLOCK_BIAS_NANOSEC;
         //syslog(LOG_CRIT, "RTSEQ: scale dt=%lf @ sec=%lf after=%lf with dt=%lf\n", scale_dt, current_time, last_time, delta_t);
 #else
         // If not using DRIFT_CONTROL, set delay_time and scale_dt to default values
@@ -249,16 +451,8 @@ void *Sequencer(void *threadp) {
 
         // Check for ABS_DELAY flag to conditionally update delay_time
 #ifdef ABS_DELAY
-        // Get the current real-time clock value and add it to delay_time
-        clock_gettime(CLOCK_REALTIME, &current_time_val);
-        delay_time.tv_sec = current_time_val.tv_sec;
-        delay_time.tv_nsec = current_time_val.tv_nsec + delay_time.tv_nsec;
-
-        // Adjust delay_time if the nanosecond part exceeds a second
-        if (delay_time.tv_nsec > NANOSEC_PER_SEC) {
-            delay_time.tv_sec = delay_time.tv_sec + 1;
-            delay_time.tv_nsec = delay_time.tv_nsec - NANOSEC_PER_SEC;
-        }
+        // Get the current real-time clock value and add it to delay_time, normalized
+        delay_time = rt_time_to_ts(rt_time_real() + delay_time.tv_nsec);
         //syslog(LOG_CRIT, "RTSEQ: cycle %08llu delay for dt=%lf @ sec=%d, nsec=%d to sec=%d, nsec=%d\n", seqCnt, scale_dt, current_time_val.tv_sec, current_time_val.tv_nsec, delay_time.tv_sec, delay_time.tv_nsec);
 #endif
 
@@ -274,11 +468,13 @@ void *Sequencer(void *threadp) {
 
             // Check if interrupted by a signal
             if (rc == EINTR) {
-                syslog(LOG_CRIT, "RTSEQ: EINTR @ sec=%lf\n", current_time);
+                log_sysf(COURSE, ASSIGNMENT, "RTSEQ: EINTR @ sec=%lld.%06lld\n", (long long)(current_time / RT_NSEC_PER_SEC),
+                         (long long)((current_time % RT_NSEC_PER_SEC) / RT_NSEC_PER_USEC));
                 delay_cnt++;
             }
             // Check for other errors during sleep
             else if (rc < 0) {
+                rt_pool_unmark_rt_thread();
                 perror("RTSEQ: nanosleep");
                 exit(-1);
             }
@@ -286,218 +482,656 @@ void *Sequencer(void *threadp) {
             //syslog(LOG_CRIT, "RTSEQ: WOKE UP\n");
         } while (rc == EINTR);
 
+        // Start interference accounting for this sequencer cycle
+        svc_stats_begin(&svc_stats[0]);
+
+#ifdef ABS_DELAY
+        // Wake-up lateness against the absolute release time is the sequencer's release latency
+        wake_late_ns = rt_time_sub(rt_time_real(), rt_time_from_ts(&delay_time));
+        if (wake_late_ns >= 0)
+            svc_stats_released(&svc_stats[0], svc_stats[0].start_ns - wake_late_ns);
+#endif
+
         // syslog(LOG_CRIT, "RTSEQ: cycle %08llu @ sec=%lf, last=%lf, dt=%lf, sdt=%lf\n", seqCnt, current_time, last_time, (current_time-last_time), scale_dt);
 
+        // Split the time for the log lines here, no floating point on the release path
+        run_sec = current_time / RT_NSEC_PER_SEC;
+        run_usec = (current_time % RT_NSEC_PER_SEC) / RT_NSEC_PER_USEC;
+
         // Release services at specific rates based on the sequence count
 
         // Service_1 = Period 2
         if ((seqCnt % 2) == 0) {
-            // Construct a message string for syslog with thread-specific information
-            sprintf(msg, "Thread 1 start %d @ %lf on core %d \n",
-                    seqCnt + 1,
-                    current_time,
-                    sched_getcpu());
-            // Log the message to syslog with specified course and assignment identifiers
-            log_sys(msg, COURSE, ASSIGNMENT);
-            // Post the semaphore for Service_1
+            // Log the release, only its format id and arguments are queued, the writer thread formats it
+            log_sysf(COURSE, ASSIGNMENT, "Thread 1 start %llu @ %lld.%06lld on core %d \n", seqCnt + 1, run_sec, run_usec, sched_getcpu());
+            // The previous release still not done at this one missed its deadline (D=T)
+            missed = (seqCnt > 0 && atomic_load_explicit(&svc_done[1], memory_order_acquire) < seqCnt / 2);
+            if (missed)
+                trace_event(TRACE_EV_DEADLINE_MISS, 1, seqCnt / 2, 0);
+            // Publish the release to the live metrics segment
+            rt_metrics_released(1, svc_stats[0].start_ns, missed);
+            // Stamp the release for the service's latency histograms
+            atomic_store_explicit(&svc_release_ns[1], svc_stats[0].start_ns, memory_order_release);
+            // Trace the release with the service's release number, before the service can start it
+            trace_event(TRACE_EV_RELEASE, 1, seqCnt / 2 + 1, 0);
+            // Count the release, then post the semaphore for Service_1
+            atomic_fetch_add_explicit(&svc_released[1], 1, memory_order_release);
             sem_post(&semS1);
         }
         // Service_2 = Period 5
         if ((seqCnt % 5) == 0) {
-            // Construct a message string for syslog with thread-specific information
-            sprintf(msg, "Thread 2 start %d @ %lf on core %d \n",
-                    seqCnt + 1,
-                    current_time,
-                    sched_getcpu());
-            // Log the message to syslog with specified course and assignment identifiers
-            log_sys(msg, COURSE, ASSIGNMENT);
-            // Post the semaphore for Service_2
+            // Log the release, only its format id and arguments are queued, the writer thread formats it
+            log_sysf(COURSE, ASSIGNMENT, "Thread 2 start %llu @ %lld.%06lld on core %d \n", seqCnt + 1, run_sec, run_usec, sched_getcpu());
+            // The previous release still not done at this one missed its deadline (D=T)
+            missed = (seqCnt > 0 && atomic_load_explicit(&svc_done[2], memory_order_acquire) < seqCnt / 5);
+            if (missed)
+                trace_event(TRACE_EV_DEADLINE_MISS, 2, seqCnt / 5, 0);
+            // Publish the release to the live metrics segment
+            rt_metrics_released(2, svc_stats[0].start_ns, missed);
+            // Stamp the release for the service's latency histograms
+            atomic_store_explicit(&svc_release_ns[2], svc_stats[0].start_ns, memory_order_release);
+            // Trace the release with the service's release number, before the service can start it
+            trace_event(TRACE_EV_RELEASE, 2, seqCnt / 5 + 1, 0);
+            // Count the release, then post the semaphore for Service_2
+            atomic_fetch_add_explicit(&svc_released[2], 1, memory_order_release);
             sem_post(&semS2);
         }
         // Service_3 = Period 10
         if ((seqCnt % 7) == 0) {
-            // Construct a message string for syslog with thread-specific information
-            sprintf(msg, "Thread 3 start %d @ %lf on core %d \n",
-                    seqCnt + 1,
-                    current_time,
-                    sched_getcpu());
-            // Log the message to syslog with specified course and assignment identifiers
-            log_sys(msg, COURSE, ASSIGNMENT);
-            // Post the semaphore for Service_3
+            // Log the release, only its format id and arguments are queued, the writer thread formats it
+            log_sysf(COURSE, ASSIGNMENT, "Thread 3 start %llu @ %lld.%06lld on core %d \n", seqCnt + 1, run_sec, run_usec, sched_getcpu());
+            // The previous release still not done at this one missed its deadline (D=T)
+            missed = (seqCnt > 0 && atomic_load_explicit(&svc_done[3], memory_order_acquire) < seqCnt / 7);
+            if (missed)
+                trace_event(TRACE_EV_DEADLINE_MISS, 3, seqCnt / 7, 0);
+            // Publish the release to the live metrics segment
+            rt_metrics_released(3, svc_stats[0].start_ns, missed);
+            // Stamp the release for the service's latency histograms
+            atomic_store_explicit(&svc_release_ns[3], svc_stats[0].start_ns, memory_order_release);
+            // Trace the release with the service's release number, before the service can start it
+            trace_event(TRACE_EV_RELEASE, 3, seqCnt / 7 + 1, 0);
+            // Count the release, then post the semaphore for Service_3
+            atomic_fetch_add_explicit(&svc_released[3], 1, memory_order_release);
             sem_post(&semS3);
         }
         // Service_4 = Period 20
         if ((seqCnt % 13) == 0) {
-            // Construct a message string for syslog with thread-specific information
-            sprintf(msg, "Thread 4 start %d @ %lf on core %d \n",
-                    seqCnt + 1,
-                    current_time,
-                    sched_getcpu());
-            // Log the message to syslog with specified course and assignment identifiers
-            log_sys(msg, COURSE, ASSIGNMENT);
-            // Post the semaphore for Service_4
-            sem_post(&semS3);
+            // Log the release, only its format id and arguments are queued, the writer thread formats it
+            log_sysf(COURSE, ASSIGNMENT, "Thread 4 start %llu @ %lld.%06lld on core %d \n", seqCnt + 1, run_sec, run_usec, sched_getcpu());
+            // The previous release still not done at this one missed its deadline (D=T)
+            missed = (seqCnt > 0 && atomic_load_explicit(&svc_done[4], memory_order_acquire) < seqCnt / 13);
+            if (missed)
+                trace_event(TRACE_EV_DEADLINE_MISS, 4, seqCnt / 13, 0);
+            // Publish the release to the live metrics segment
+            rt_metrics_released(4, svc_stats[0].start_ns, missed);
+            // Trace the release with the service's release number, before the service can start it
+            trace_event(TRACE_EV_RELEASE, 4, seqCnt / 13 + 1, 0);
+            // Post the eventfd release for Service_4
+            rt_release_post(&releaseS4);
         }
 
+        // Close the accounting for this cycle and publish it
+        rel = svc_stats_end(&svc_stats[0]);
+        rt_service_release_done(0, rel->exec_ns);
+        rt_metrics_released(0, svc_stats[0].start_ns, 0);
+        rt_metrics_completed(0, rel->latency_ns, rel->exec_ns);
+
+        // A cycle that ends past its period overran, the next releases will be late
+        over_ns = wake_late_ns + (long long)rel->exec_ns - RTSEQ_DELAY_NSEC;
+        if (over_ns > 0)
+            trace_event(TRACE_EV_OVERRUN, 0, seqCnt + 1, over_ns);
+
+        // Hand a histogram dump to a best-effort worker, a full queue just skips this one
+        if (seqCnt > 0 && (seqCnt % HIST_DUMP_CYCLES) == 0)
+            offload_submit(&offload_pool, hist_dump_job, NULL);
+
         // Increment sequence count and update last_time
         seqCnt++;
         last_time = current_time;
 
     } while (!abortTest && (seqCnt < threadParams->sequencePeriods));
 
-    // Post semaphores and set abort flags before exiting the thread
-    sem_post(&semS1);
-    sem_post(&semS2);
-    sem_post(&semS3);
-    sem_post(&semS4);
+    // Heap use is allowed again, shutdown and thread exit may allocate
+    rt_pool_unmark_rt_thread();
+
+    // Set abort flags, then post so each service wakes to see its flag, not a release
     abortS1 = TRUE;
     abortS2 = TRUE;
     abortS3 = TRUE;
-    abortS4 = TRUE;
+    sem_post(&semS1);
+    sem_post(&semS2);
+    sem_post(&semS3);
+
+    // Service_4 runs an event loop, tell it to stop with a control message
+    ctrl = SERVICE_CTRL_STOP;
+    if (write(controlS4[1], &ctrl, 1) != 1)
+        perror("RTSEQ: stop S4");
 
     // Exit the thread
     pthread_exit((void *)0);
 }
 
+// Service_1 warm-up body, writes the test pattern into a frame no stage reads.
+// Claiming a ring slot here would hand the stages a frame that was never acquired.
+unsigned char warmup_frame[FRAME_SIZE];
+
+static void acquire_warmup(void *arg)
+{
+    memset(warmup_frame, 0, FRAME_SIZE);
+}
+
 void *Service_1(void *threadp)
 {
     // Store current time 
-    double current_time;
+    rt_ns_t current_time;
 
     // Initialize a counter for Service 1
     unsigned long long S1Cnt = 0;
 
+    // Frame slot being acquired into
+    frame_slot_t *frame;
+
      // Casts the input thread parameter to a specific structure type
     threadParams_t *threadParams = (threadParams_t *)threadp;
 
-    // Continuously execute the following block until abort
-    while (!abortS1)
+    // Interference and execution time of the release just completed
+    const svc_release_t *rel;
+
+#ifdef SERVICE_WARMUP
+    // Warm-up state, run once before the first release
+    svc_warmup_t warmup;
+#endif
+
+    // No heap allocation from here on, trapped when built with RT_MALLOC_GUARD
+    rt_pool_mark_rt_thread();
+
+    // Take a trace ring for this service's release events
+    trace_thread_init("S1");
+
+#ifdef SERVICE_WARMUP
+    // Prefault the stack, read the frame store, the stages may be reading it too, and fill a dummy frame
+    svc_warmup_init(&warmup, SVC_WARMUP_STACK, acquire_warmup, NULL, 2);
+    svc_warmup_add_buffer(&warmup, frame_ring.store, FRAME_RING_SLOTS * FRAME_SIZE, FALSE);
+    svc_stats[1].warmup_ns = svc_warmup_run(&warmup);
+#endif
+
+    // Continuously execute the following block until abort and every posted release is done
+    while (!abortS1 || S1Cnt < atomic_load_explicit(&svc_released[1], memory_order_acquire))
     {
         // Wait for a semaphore signal to proceed
         sem_wait(&semS1);
 
+        // The shutdown post is not a release, leave before any accounting. A release
+        // posted before the abort is still run, the abort can be seen before it.
+        if (abortS1 && S1Cnt >= atomic_load_explicit(&svc_released[1], memory_order_acquire))
+            break;
+
         // Increment the counter for Service 1
         S1Cnt++;
 
-        // Get the current time in milliseconds
-        current_time = getTimeMsec();
+        // Get the current time in nanoseconds
+        current_time = getTimeNsec();
 
-        // syslog(LOG_CRIT, "S1: release %llu @ sec=%lf\n", S1Cnt, current_time);
+        // Start interference accounting for this release
+        svc_stats_begin(&svc_stats[1]);
+        svc_stats_released(&svc_stats[1], atomic_load_explicit(&svc_release_ns[1], memory_order_acquire));
+        trace_event(TRACE_EV_START, 1, S1Cnt, 0);
+
+        // Claim a free slot and acquire straight into it, an overrun is counted by the ring
+        frame = frame_ring_claim(&frame_ring);
+        if (frame != NULL) {
+            // No camera on this target, so fill the slot with a test pattern in place
+            memset(frame->data, (unsigned char)S1Cnt, FRAME_SIZE);
+            frame_ring_publish(&frame_ring, frame, FRAME_SIZE);
+        }
+
+        // Report execution time for the schedulability analysis
+        rel = svc_stats_end(&svc_stats[1]);
+        rt_service_release_done(1, rel->exec_ns);
+
+        // Log the release to this thread's trace ring instead of syslog, no system call
+        if (rel->nivcsw > 0)
+            trace_event(TRACE_EV_PREEMPTED, 1, S1Cnt, rel->nivcsw);
+        trace_event(TRACE_EV_COMPLETE, 1, S1Cnt, rel->exec_ns);
+        if (rel->exec_ns > SVC_BUDGET_NS(2))
+            trace_event(TRACE_EV_BUDGET, 1, S1Cnt, rel->exec_ns);
+        rt_metrics_completed(1, rel->latency_ns, rel->exec_ns);
+        atomic_store_explicit(&svc_done[1], S1Cnt, memory_order_release);
     }
 
+    // Heap use is allowed again, thread exit may allocate
+    rt_pool_unmark_rt_thread();
+
     // Exit the thread with a return value of 0
     pthread_exit((void *)0);
 }
 
+// Service_2 warm-up body, publishes the time-stamp it reads back unchanged. S2 is the
+// mailbox's only writer, so readers see the same value; no frame is taken from the ring.
+static void timestamp_warmup(void *arg)
+{
+    frame_stamp_t stamp;
+
+    mailbox_read(&timestamp_mb, &stamp);
+    mailbox_write(&timestamp_mb, &stamp);
+}
+
 void *Service_2(void *threadp)
 {
     // Store current time 
-    double current_time;
+    rt_ns_t current_time;
 
     // Initialize a counter for Service 1
     unsigned long long S2Cnt = 0;
 
+    // Latest frame and its time-stamp
+    frame_slot_t *frame;
+    frame_stamp_t stamp;
+
     // Casts the input thread parameter to a specific structure type
     threadParams_t *threadParams = (threadParams_t *)threadp;
 
-    // Continuously execute the following block until abort
-    while (!abortS2)
+    // Interference and execution time of the release just completed
+    const svc_release_t *rel;
+
+#ifdef SERVICE_WARMUP
+    // Warm-up state, run once before the first release
+    svc_warmup_t warmup;
+#endif
+
+    // No heap allocation from here on, trapped when built with RT_MALLOC_GUARD
+    rt_pool_mark_rt_thread();
+
+    // Take a trace ring for this service's release events
+    trace_thread_init("S2");
+
+#ifdef SERVICE_WARMUP
+    // Prefault the stack, read the mailbox it publishes to and run the publish once more
+    svc_warmup_init(&warmup, SVC_WARMUP_STACK, timestamp_warmup, NULL, 2);
+    svc_warmup_add_buffer(&warmup, &timestamp_mb, sizeof(timestamp_mb), FALSE);
+    svc_stats[2].warmup_ns = svc_warmup_run(&warmup);
+#endif
+
+    // Continuously execute the following block until abort and every posted release is done
+    while (!abortS2 || S2Cnt < atomic_load_explicit(&svc_released[2], memory_order_acquire))
     {
         // Wait for a semaphore signal to proceed
         sem_wait(&semS2);
 
+        // The shutdown post is not a release, leave before any accounting. A release
+        // posted before the abort is still run, the abort can be seen before it.
+        if (abortS2 && S2Cnt >= atomic_load_explicit(&svc_released[2], memory_order_acquire))
+            break;
+
         // Increment the counter for Service 2
         S2Cnt++;
 
-        // Get the current time in milliseconds
-        current_time = getTimeMsec();
+        // Get the current time in nanoseconds
+        current_time = getTimeNsec();
+
+        // Start interference accounting for this release
+        svc_stats_begin(&svc_stats[2]);
+        svc_stats_released(&svc_stats[2], atomic_load_explicit(&svc_release_ns[2], memory_order_acquire));
+        trace_event(TRACE_EV_START, 2, S2Cnt, 0);
+
+        // Time-stamp the newest frame in place, older frames are released unread
+        frame = frame_ring_acquire_latest(&frame_ring, stage_timestamp);
+        if (frame != NULL) {
+            stamp.frame_seq = frame->seq;
+            stamp.frame_time = frame->timestamp;
 
-        // syslog(LOG_CRIT, "S2: release %llu @ sec=%lf\n", S2Cnt, current_time);
+            // Publish the time-stamp for the save service
+            mailbox_write(&timestamp_mb, &stamp);
+
+            frame_ring_release(&frame_ring, frame);
+        }
+
+        // Report execution time for the schedulability analysis
+        rel = svc_stats_end(&svc_stats[2]);
+        rt_service_release_done(2, rel->exec_ns);
+
+        // Log the release to this thread's trace ring instead of syslog, no system call
+        if (rel->nivcsw > 0)
+            trace_event(TRACE_EV_PREEMPTED, 2, S2Cnt, rel->nivcsw);
+        trace_event(TRACE_EV_COMPLETE, 2, S2Cnt, rel->exec_ns);
+        if (rel->exec_ns > SVC_BUDGET_NS(5))
+            trace_event(TRACE_EV_BUDGET, 2, S2Cnt, rel->exec_ns);
+        rt_metrics_completed(2, rel->latency_ns, rel->exec_ns);
+        atomic_store_explicit(&svc_done[2], S2Cnt, memory_order_release);
     }
 
+    // Heap use is allowed again, thread exit may allocate
+    rt_pool_unmark_rt_thread();
+
     // Exits the thread with a return value of 0
     pthread_exit((void *)0);
 }
 
 
+// Difference of two frames into diff, returns the sum of the difference image
+static unsigned long difference_image(const unsigned char *cur, const unsigned char *prev, unsigned char *diff)
+{
+    unsigned long diff_sum = 0;
+    int i;
+
+    for (i = 0; i < FRAME_SIZE; i++) {
+        diff[i] = abs((int)cur[i] - (int)prev[i]);
+        diff_sum += diff[i];
+    }
+
+    return diff_sum;
+}
+
+// Service_3 warm-up body, differences a dummy frame held in the arena against itself
+static void difference_warmup(void *arg)
+{
+    unsigned char *dummy;
+
+    rt_arena_reset(&diff_arena);
+    dummy = rt_arena_alloc(&diff_arena, FRAME_SIZE);
+    if (dummy != NULL)
+        difference_image(dummy, dummy, dummy);
+    rt_arena_reset(&diff_arena);
+}
+
 void *Service_3(void *threadp)
 {
     // Store current time 
-    double current_time;
+    rt_ns_t current_time;
 
     // Initialize a counter for Service 2
     unsigned long long S3Cnt=0;
 
+    // Current and previous frames, the previous one is held by reference until replaced
+    frame_slot_t *frame, *prev_frame = NULL;
+    unsigned char *diff_image;
+    unsigned long diff_sum;
+
     // Casts the input thread parameter to a specific structure type
     threadParams_t *threadParams = (threadParams_t *)threadp;
 
-    // Continuously execute the following block until abort 
-    while(!abortS3)
+    // Interference and execution time of the release just completed
+    const svc_release_t *rel;
+
+#ifdef SERVICE_WARMUP
+    // Warm-up state, run once before the first release
+    svc_warmup_t warmup;
+#endif
+
+    // No heap allocation from here on, trapped when built with RT_MALLOC_GUARD
+    rt_pool_mark_rt_thread();
+
+    // Take a trace ring for this service's release events
+    trace_thread_init("S3");
+
+#ifdef SERVICE_WARMUP
+    // Prefault the stack, read the frame store, dirty the arena and run the difference on dummy data
+    svc_warmup_init(&warmup, SVC_WARMUP_STACK, difference_warmup, NULL, 2);
+    svc_warmup_add_buffer(&warmup, frame_ring.store, FRAME_RING_SLOTS * FRAME_SIZE, FALSE);
+    svc_warmup_add_buffer(&warmup, diff_arena.mem, diff_arena.size, TRUE);
+    svc_stats[3].warmup_ns = svc_warmup_run(&warmup);
+#endif
+
+    // Continuously execute the following block until abort and every posted release is done
+    while (!abortS3 || S3Cnt < atomic_load_explicit(&svc_released[3], memory_order_acquire))
     {
         // Wait for a semaphore signal to proceed
         sem_wait(&semS3);
 
+        // The shutdown post is not a release, leave before any accounting. A release
+        // posted before the abort is still run, the abort can be seen before it.
+        if (abortS3 && S3Cnt >= atomic_load_explicit(&svc_released[3], memory_order_acquire))
+            break;
+
         // Increment the counter for Service 3
         S3Cnt++;
 
-        // Get the current time in milliseconds
-        current_time=getTimeMsec();
+        // Get the current time in nanoseconds
+        current_time=getTimeNsec();
+
+        // Start interference accounting for this release
+        svc_stats_begin(&svc_stats[3]);
+        svc_stats_released(&svc_stats[3], atomic_load_explicit(&svc_release_ns[3], memory_order_acquire));
+        trace_event(TRACE_EV_START, 3, S3Cnt, 0);
         
-        // syslog(LOG_CRIT, "S3: release %llu @ sec=%lf\n", S3Cnt, current_time);
+        // Scratch memory from the last release is discarded
+        rt_arena_reset(&diff_arena);
+
+        // Difference the newest frame against the previous one without copying either
+        frame = frame_ring_acquire_latest(&frame_ring, stage_difference);
+        if (frame != NULL) {
+            if (prev_frame != NULL) {
+                // The difference image lives in this release's arena
+                diff_image = rt_arena_alloc(&diff_arena, FRAME_SIZE);
+                if (diff_image != NULL) {
+                    diff_sum = difference_image(frame->data, prev_frame->data, diff_image);
+
+                    // Publish the difference result for the save service
+                    mailbox_write(&difference_mb, &diff_sum);
+                }
+                frame_ring_release(&frame_ring, prev_frame);
+            }
+            prev_frame = frame;
+        }
+
+        // Report execution time for the schedulability analysis
+        rel = svc_stats_end(&svc_stats[3]);
+        rt_service_release_done(3, rel->exec_ns);
+
+        // Log the release to this thread's trace ring instead of syslog, no system call
+        if (rel->nivcsw > 0)
+            trace_event(TRACE_EV_PREEMPTED, 3, S3Cnt, rel->nivcsw);
+        trace_event(TRACE_EV_COMPLETE, 3, S3Cnt, rel->exec_ns);
+        if (rel->exec_ns > SVC_BUDGET_NS(7))
+            trace_event(TRACE_EV_BUDGET, 3, S3Cnt, rel->exec_ns);
+        rt_metrics_completed(3, rel->latency_ns, rel->exec_ns);
+        atomic_store_explicit(&svc_done[3], S3Cnt, memory_order_release);
     }
 
+    // Heap use is allowed again, thread exit may allocate
+    rt_pool_unmark_rt_thread();
+
+    // Give back the frame still held for differencing
+    if (prev_frame != NULL)
+        frame_ring_release(&frame_ring, prev_frame);
+
     // Exit the thread with a return value of 0
     pthread_exit((void *)0);
 }
 
+// Offloaded part of Service_4, runs on a SCHED_OTHER worker.
+// Frames are appended as a stream of PGM images with the analysis results in a comment.
+static void save_frame_job(void *arg)
+{
+    save_job_t *job = (save_job_t *)arg;
+    char header[128];
+    int len;
+
+    len = snprintf(header, sizeof(header), "P5\n# seq=%llu time=%ld.%09ld diff=%lu\n%d %d\n255\n",
+                   job->frame->seq, (long)job->info.frame_time.tv_sec, job->info.frame_time.tv_nsec,
+                   job->info.diff_sum, FRAME_WIDTH, FRAME_HEIGHT);
+
+    if (frames_fd >= 0 && (write(frames_fd, header, len) < 0 || write(frames_fd, job->frame->data, job->frame->size) < 0))
+        perror("save frame");
+
+    frame_ring_release(&frame_ring, job->frame);
+    rt_pool_free(&save_job_pool, job);
+}
+
+// Service_4 warm-up body, reads the results and fills a save job it gives straight back.
+// Nothing is submitted, the worker would write a frame that was never acquired.
+static void save_warmup(void *arg)
+{
+    frame_stamp_t stamp;
+    save_job_t *job;
+
+    job = rt_pool_alloc(&save_job_pool);
+    if (job != NULL) {
+        mailbox_read(&timestamp_mb, &stamp);
+        mailbox_read(&difference_mb, &job->info.diff_sum);
+        job->info.frame_seq = stamp.frame_seq;
+        job->info.frame_time = stamp.frame_time;
+        job->frame = NULL;
+        rt_pool_free(&save_job_pool, job);
+    }
+}
+
 void *Service_4(void *threadp)
 {
     // Store current time 
-    double current_time;
+    rt_ns_t current_time;
 
-    // Initialize a counter for Service 4
+    // Number of the newest release Service 4 has run, as the Sequencer numbers it
     unsigned long long S4Cnt = 0;
 
+    // Releases covered so far, the same as S4Cnt once a run completes
+    unsigned long long S4Done = 0;
+
+    // Latest frame to save and the message handing it to the worker
+    frame_slot_t *frame;
+    save_job_t *job;
+
+    // Analysis results at this release and the last time-stamp saved
+    frame_stamp_t stamp;
+    frame_info_t info;
+    unsigned long long saved_seq = 0;
+
+    // Event loop state
+    struct epoll_event ev, events[SERVICE_MAX_EVENTS];
+    int epfd, nevents, i, running = TRUE;
+    unsigned long long released;
+    char ctrl;
+
      // Casts the input thread parameter to a specific structure type
     threadParams_t *threadParams = (threadParams_t *)threadp;
 
-    // Continuously execute the following block until abort
-    while (!abortS4)
+    // Interference and execution time of the release just completed
+    const svc_release_t *rel;
+
+#ifdef SERVICE_WARMUP
+    // Warm-up state, run once before the first release
+    svc_warmup_t warmup;
+#endif
+
+    // One epoll set takes the release and control messages, and any I/O the service takes on
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) { perror("S4: epoll_create1"); pthread_exit((void *)-1); }
+    ev.events = EPOLLIN;
+    ev.data.fd = rt_release_fd(&releaseS4);
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, ev.data.fd, &ev)) perror("S4: epoll add release");
+    ev.data.fd = controlS4[0];
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, ev.data.fd, &ev)) perror("S4: epoll add control");
+
+    // No heap allocation from here on, trapped when built with RT_MALLOC_GUARD
+    rt_pool_mark_rt_thread();
+
+    // Take a trace ring for this service's release events
+    trace_thread_init("S4");
+
+#ifdef SERVICE_WARMUP
+    // Prefault the stack, read the mailboxes and the job pool it hands to the worker, and fill a job
+    svc_warmup_init(&warmup, SVC_WARMUP_STACK, save_warmup, NULL, 2);
+    svc_warmup_add_buffer(&warmup, &timestamp_mb, sizeof(timestamp_mb), FALSE);
+    svc_warmup_add_buffer(&warmup, &difference_mb, sizeof(difference_mb), FALSE);
+    svc_warmup_add_buffer(&warmup, save_job_pool.mem, save_job_pool.obj_size * save_job_pool.capacity, FALSE);
+    svc_stats[4].warmup_ns = svc_warmup_run(&warmup);
+#endif
+
+    // Continuously execute the following block until told to stop
+    while (running)
     {
-        // Wait for a semaphore signal to proceed
-        sem_wait(&semS4);
+        // Wait for a batch of events, one wake-up however many are ready
+        nevents = epoll_wait(epfd, events, SERVICE_MAX_EVENTS, -1);
+        if (nevents < 0) {
+            if (errno == EINTR) continue;
+            rt_pool_unmark_rt_thread();
+            perror("S4: epoll_wait");
+            break;
+        }
 
-        // Increment the counter for Service 4
-        S4Cnt++;
+        // Take every pending release and control message in the batch
+        released = 0;
+        for (i = 0; i < nevents; i++) {
+            if (events[i].data.fd == controlS4[0]) {
+                if (read(controlS4[0], &ctrl, 1) == 1 && ctrl == SERVICE_CTRL_STOP)
+                    running = FALSE;
+            } else if (events[i].data.fd == rt_release_fd(&releaseS4)) {
+                released = rt_release_consume(&releaseS4);
+            }
+        }
 
-        // Get the current time in milliseconds
-        current_time = getTimeMsec();
+        // Nothing else to do without a release, releases that piled up are run once
+        if (released == 0)
+            continue;
+
+        // Number the run after the newest release it covers so the trace pairs it with that
+        // RELEASE event, the releases coalesced into it have no START of their own
+        S4Cnt = S4Done + released;
+
+        // Get the current time in nanoseconds
+        current_time = getTimeNsec();
+
+        // Start interference accounting for this release
+        svc_stats_begin(&svc_stats[4]);
+        svc_stats_released(&svc_stats[4], atomic_load_explicit(&releaseS4.release_ns, memory_order_acquire));
+        trace_event(TRACE_EV_START, 4, S4Cnt, 0);
+
+        // Read the latest results without locking, saves happen once per new time-stamp
+        mailbox_read(&timestamp_mb, &stamp);
+        mailbox_read(&difference_mb, &info.diff_sum);
+        info.frame_seq = stamp.frame_seq;
+        info.frame_time = stamp.frame_time;
+
+        // Hand the newest frame to a best-effort worker, the RT thread never writes the file.
+        // The worker releases the frame once written; a dropped job releases it here.
+        frame = frame_ring_acquire_latest(&frame_ring, stage_save);
+        if (frame != NULL) {
+            job = (info.frame_seq > saved_seq) ? rt_pool_alloc(&save_job_pool) : NULL;
+            if (job != NULL) {
+                job->frame = frame;
+                job->info = info;
+                if (offload_submit(&offload_pool, save_frame_job, job) == 0) {
+                    saved_seq = info.frame_seq;
+                    frame = NULL;
+                } else {
+                    rt_pool_free(&save_job_pool, job);
+                }
+            }
+            if (frame != NULL)
+                frame_ring_release(&frame_ring, frame);
+        }
 
-        // syslog(LOG_CRIT, "S4: release %llu @ sec=%lf\n", S4Cnt, current_time);
+        // Report execution time for the schedulability analysis
+        rel = svc_stats_end(&svc_stats[4]);
+        rt_service_release_done(4, rel->exec_ns);
+
+        // Log the release to this thread's trace ring instead of syslog, no system call
+        if (rel->nivcsw > 0)
+            trace_event(TRACE_EV_PREEMPTED, 4, S4Cnt, rel->nivcsw);
+        trace_event(TRACE_EV_COMPLETE, 4, S4Cnt, rel->exec_ns);
+        if (rel->exec_ns > SVC_BUDGET_NS(13))
+            trace_event(TRACE_EV_BUDGET, 4, S4Cnt, rel->exec_ns);
+        rt_metrics_completed(4, rel->latency_ns, rel->exec_ns);
+        S4Done += released;
+        atomic_store_explicit(&svc_done[4], S4Done, memory_order_release);
     }
 
+    close(epfd);
+
+    // Heap use is allowed again, thread exit may allocate
+    rt_pool_unmark_rt_thread();
+
     // Exit the thread with a return value of 0
     pthread_exit((void *)0);
 }
 
 
-// Function to calculate time in milliseconds
+// Function to get the time in nanoseconds since the start
 // global start_time must be set on first call
-double getTimeMsec(void)
+rt_ns_t getTimeNsec(void)
 {
-  // Structure to hold time information
-  struct timespec event_ts = {0, 0};
-  // Variable to store the calculated time in milliseconds
-  double event_time = 0;
-
-  // Obtaining the current time using CLOCK_REALTIME
-  clock_gettime(CLOCK_REALTIME, &event_ts);
-  
-  // Calculating the time in seconds with nanoseconds converted to seconds
-  event_time = ((event_ts.tv_sec) + ((event_ts.tv_nsec) / (double)NANOSEC_PER_SEC));
-  
-  // Returning the time difference between the current time and the start time
-  return (event_time - start_time);
+  // CLOCK_REALTIME, the clock the sequencer sleeps on, read as whole nanoseconds
+  return rt_time_sub(rt_time_real(), start_time);
 }
 
 
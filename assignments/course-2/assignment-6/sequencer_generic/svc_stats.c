@@ -0,0 +1,189 @@
+/**
+ * File: svc_stats.c
+ * Author: Brad Waggle
+ * Description: Per-release context switch, page fault and migration
+ *              accounting for service threads.
+ * Date: October 18, 2026
+ */
+
+// A service brackets each release with svc_stats_begin() and svc_stats_end().
+// The deltas of getrusage(RUSAGE_THREAD) over the release tell whether the
+// thread blocked (voluntary switches), was preempted (involuntary switches)
+// or took page faults, and the core at start and end shows a migration.
+// A migration away and back to the same core is not seen as one, but it
+// always shows up as an involuntary switch.
+//
+// Each release is classed as clean or disturbed, and the worst execution
+// time of each class is kept, so a slow release can be put down to
+// interference or to the service itself.
+//
+// The first SVC_COLD_RELEASES releases after start, or after a mode change
+// marked with svc_stats_mark_cold(), are kept apart from the steady state so
+// the report shows how much slower a cold release is, and whether a
+// warm-up hook (svc_warmup.c) earns its keep.
+//
+// Release latency, response time and execution time also go into an HDR
+// style histogram per service (hdr_hist.c), so the report gives p50 to
+// p99.99 without keeping every release. Latency and response time need the
+// release time, which the service passes in with svc_stats_released().
+//
+// Cost is two getrusage() system calls per release.
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include "svc_stats.h"
+#include "rt_time.h"
+
+void svc_stats_init(svc_stats_t *st, const char *name) {
+    memset(st, 0, sizeof(*st));
+    st->name = name;
+    svc_stats_mark_cold(st);
+
+    hdr_hist_init(&st->latency_hist, "latency");
+    hdr_hist_init(&st->response_hist, "response");
+    hdr_hist_init(&st->exec_hist, "execution");
+}
+
+// The next releases run cold again, e.g. after a mode change
+void svc_stats_mark_cold(svc_stats_t *st) {
+    st->cold_windows++;
+    st->cold_left = SVC_COLD_RELEASES;
+}
+
+// Snapshot thread usage at the start of a release
+void svc_stats_begin(svc_stats_t *st) {
+    st->start_cpu = sched_getcpu();
+    st->last.latency_ns = 0;
+    getrusage(RUSAGE_THREAD, &st->start_usage);
+    st->start_ns = rt_time_mono();
+}
+
+// CLOCK_MONOTONIC time the current release was issued, call after svc_stats_begin()
+void svc_stats_released(svc_stats_t *st, unsigned long long release_ns) {
+    if (release_ns == 0 || release_ns > st->start_ns)
+        return;
+
+    st->release_ns = release_ns;
+    st->last.latency_ns = st->start_ns - release_ns;
+    hdr_hist_record(&st->latency_hist, st->start_ns - release_ns);
+}
+
+// Take the deltas for the release that just completed and fold them in
+const svc_release_t *svc_stats_end(svc_stats_t *st) {
+    struct rusage usage;
+    svc_release_t *rel = &st->last;
+    unsigned long long end_ns = rt_time_mono();
+    int i;
+
+    rel->exec_ns = end_ns - st->start_ns;
+    hdr_hist_record(&st->exec_hist, rel->exec_ns);
+    if (st->release_ns != 0) {
+        hdr_hist_record(&st->response_hist, end_ns - st->release_ns);
+        st->release_ns = 0;
+    }
+
+    getrusage(RUSAGE_THREAD, &usage);
+    rel->cpu_end = sched_getcpu();
+    rel->cpu_start = st->start_cpu;
+
+    rel->nvcsw = usage.ru_nvcsw - st->start_usage.ru_nvcsw;
+    rel->nivcsw = usage.ru_nivcsw - st->start_usage.ru_nivcsw;
+    rel->minflt = usage.ru_minflt - st->start_usage.ru_minflt;
+    rel->majflt = usage.ru_majflt - st->start_usage.ru_majflt;
+    rel->migrated = (rel->cpu_end != rel->cpu_start);
+
+    st->releases++;
+    st->nvcsw += rel->nvcsw;
+    st->nivcsw += rel->nivcsw;
+    st->minflt += rel->minflt;
+    st->majflt += rel->majflt;
+    st->migrations += rel->migrated;
+
+    if (rel->nivcsw > st->max_nivcsw) st->max_nivcsw = rel->nivcsw;
+    if (rel->minflt > st->max_minflt) st->max_minflt = rel->minflt;
+    if (rel->majflt > st->max_majflt) st->max_majflt = rel->majflt;
+
+    if (rel->nivcsw > 0) st->preempted++;
+    if (rel->minflt > 0 || rel->majflt > 0) st->faulted++;
+    if (rel->migrated) st->migrated++;
+
+    if (rel->nivcsw == 0 && rel->minflt == 0 && rel->majflt == 0 && !rel->migrated) {
+        st->clean_releases++;
+        if (rel->exec_ns > st->max_clean_exec_ns)
+            st->max_clean_exec_ns = rel->exec_ns;
+    } else if (rel->exec_ns > st->max_disturbed_exec_ns) {
+        st->max_disturbed_exec_ns = rel->exec_ns;
+    }
+
+    if (st->cold_left > 0) {
+        i = SVC_COLD_RELEASES - st->cold_left--;
+        if (rel->exec_ns > st->cold_exec_ns[i])
+            st->cold_exec_ns[i] = rel->exec_ns;
+    } else {
+        st->steady_releases++;
+        st->steady_sum_ns += rel->exec_ns;
+    }
+
+    return rel;
+}
+
+void svc_stats_report(svc_stats_t *stats, int count) {
+    svc_stats_t *st;
+    double steady;
+    int i, j;
+
+    printf("Service interference per release (totals, worst release):\n");
+    printf("  %-12s %8s %8s %12s %12s %12s %8s %14s %14s\n", "service", "releases", "vcsw",
+           "ivcsw(max)", "minflt(max)", "majflt(max)", "migr", "clean max us", "disturbed max us");
+
+    for (i = 0; i < count; i++) {
+        st = &stats[i];
+        printf("  %-12s %8llu %8llu %7llu(%3ld) %7llu(%3ld) %7llu(%3ld) %8llu %14.1f %14.1f\n",
+               st->name, st->releases, st->nvcsw, st->nivcsw, st->max_nivcsw,
+               st->minflt, st->max_minflt, st->majflt, st->max_majflt, st->migrations,
+               st->max_clean_exec_ns / 1000.0, st->max_disturbed_exec_ns / 1000.0);
+        printf("  %-12s preempted=%llu faulted=%llu migrated=%llu clean=%llu\n", "",
+               st->preempted, st->faulted, st->migrated, st->clean_releases);
+    }
+
+    printf("Cold release penalty (worst over cold windows, x steady mean):\n");
+    printf("  %-12s %10s %12s", "service", "warmup us", "steady us");
+    for (j = 0; j < SVC_COLD_RELEASES; j++)
+        printf("      cold %d", j + 1);
+    printf("\n");
+
+    for (i = 0; i < count; i++) {
+        st = &stats[i];
+        steady = (st->steady_releases > 0) ? (double)st->steady_sum_ns / st->steady_releases : 0.0;
+        printf("  %-12s %10.1f %12.1f", st->name, st->warmup_ns / 1000.0, steady / 1000.0);
+        for (j = 0; j < SVC_COLD_RELEASES; j++) {
+            if (st->cold_exec_ns[j] == 0 || steady == 0.0)
+                printf(" %11s", "-");
+            else
+                printf(" %10.1fx", st->cold_exec_ns[j] / steady);
+        }
+        printf("\n");
+    }
+}
+
+// Latency percentiles, safe to call while the services run
+void svc_stats_report_hist(svc_stats_t *stats, int count) {
+    hdr_hist_t *hists[3];
+    char line[256];
+    int i, j;
+
+    printf("Release latency, response and execution time:\n");
+    for (i = 0; i < count; i++) {
+        hists[0] = &stats[i].latency_hist;
+        hists[1] = &stats[i].response_hist;
+        hists[2] = &stats[i].exec_hist;
+        for (j = 0; j < 3; j++) {
+            hdr_hist_format(hists[j], line, sizeof(line));
+            printf("  %-12s %s\n", stats[i].name, line);
+        }
+    }
+}
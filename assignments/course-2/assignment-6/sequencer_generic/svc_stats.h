@@ -0,0 +1,71 @@
+#ifndef SVC_STATS_H
+#define SVC_STATS_H
+
+#include <sys/resource.h>
+#include "hdr_hist.h"
+
+// Releases after a start or mode change that count as cold
+#define SVC_COLD_RELEASES (4)
+
+// What happened to a service thread during one release
+typedef struct
+{
+    unsigned long long exec_ns;     // wall time from release start to completion
+    unsigned long long latency_ns;  // release to start, 0 if no release time was given
+    long nvcsw;                     // voluntary context switches (blocked)
+    long nivcsw;                    // involuntary context switches (preempted)
+    long minflt;                    // minor page faults
+    long majflt;                    // major page faults
+    int cpu_start;
+    int cpu_end;
+    int migrated;                   // finished on a different core than it started
+} svc_release_t;
+
+// Per service aggregate, only written by the service's own thread
+typedef struct
+{
+    const char *name;
+    unsigned long long releases;
+
+    unsigned long long nvcsw, nivcsw, minflt, majflt, migrations;
+    long max_nivcsw, max_minflt, max_majflt;
+
+    unsigned long long preempted;   // releases with involuntary switches
+    unsigned long long faulted;     // releases with page faults
+    unsigned long long migrated;    // releases that changed core
+
+    // Worst execution time of undisturbed releases versus disturbed ones
+    unsigned long long clean_releases;
+    unsigned long long max_clean_exec_ns;
+    unsigned long long max_disturbed_exec_ns;
+
+    // Cold releases versus the steady state, the worst of each cold position
+    // is kept over all cold windows
+    unsigned long long warmup_ns;   // time spent in the warm-up hook, 0 if none
+    unsigned long long cold_windows;
+    unsigned long long cold_exec_ns[SVC_COLD_RELEASES];
+    int cold_left;                  // releases still counted as cold in this window
+    unsigned long long steady_releases;
+    unsigned long long steady_sum_ns;
+
+    // Latency distributions, recorded by the service's own thread
+    hdr_hist_t latency_hist;        // release to start
+    hdr_hist_t response_hist;       // release to completion
+    hdr_hist_t exec_hist;           // start to completion
+    unsigned long long release_ns;  // release of the current release, 0 if not given
+
+    struct rusage start_usage;
+    unsigned long long start_ns;
+    int start_cpu;
+    svc_release_t last;
+} svc_stats_t;
+
+void svc_stats_init(svc_stats_t *st, const char *name);
+void svc_stats_mark_cold(svc_stats_t *st);
+void svc_stats_begin(svc_stats_t *st);
+void svc_stats_released(svc_stats_t *st, unsigned long long release_ns);
+const svc_release_t *svc_stats_end(svc_stats_t *st);
+void svc_stats_report(svc_stats_t *stats, int count);
+void svc_stats_report_hist(svc_stats_t *stats, int count);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef SVC_WARMUP_H
+#define SVC_WARMUP_H
+
+#include <stddef.h>
+
+// Working buffers a service can name for warm-up
+#define SVC_WARMUP_MAX_BUFFERS (4)
+
+// Stack prefaulted when the service does not say, matches CORO_STACK_SIZE
+#define SVC_WARMUP_STACK (16 * 1024)
+
+typedef void (*svc_warmup_fn_t)(void *arg);
+
+// Work done once by a service thread before its first release
+typedef struct
+{
+    struct {
+        void *addr;
+        size_t size;
+        int writable;               // also dirty the pages, only for buffers the service owns
+    } buffers[SVC_WARMUP_MAX_BUFFERS];
+    int num_buffers;
+
+    size_t stack_bytes;             // stack depth to prefault below the caller
+    svc_warmup_fn_t body;           // release body run on dummy data, may be NULL
+    void *arg;
+    int iterations;                 // times body is run
+} svc_warmup_t;
+
+void svc_warmup_init(svc_warmup_t *w, size_t stack_bytes, svc_warmup_fn_t body, void *arg, int iterations);
+int svc_warmup_add_buffer(svc_warmup_t *w, void *addr, size_t size, int writable);
+unsigned long long svc_warmup_run(svc_warmup_t *w);
+
+#endif
@@ -1,21 +1,141 @@
 /**
  * File: sys_logger.c
  * Author: Brad Waggle
- * Description: Utilites for clearing, writing, copying the syslog.
+ * Description: Utilites for writing the syslog and the per-run log file.
  * Date: October 27, 2023
  */
 
+// log_sys() used to call openlog(), syslog() and closelog() for every
+// message, a socket round trip to the syslog daemon on the caller's thread.
+// After log_sys_start() it only copies the message and its time into a
+// bounded queue. A writer thread on the non-RT cores formats the queued
+// messages the way syslog() would and sends them over one pre-opened
+// /dev/log socket, a whole batch per sendmmsg() call.
+//
+// The queue is a bounded multi-producer ring with a turn counter per cell,
+// the same design as offload_pool.c. Callers never take a lock and only
+// make a system call to wake the writer when the queue is half full,
+// otherwise the writer drains it every LOG_FLUSH_PERIOD_US. What happens
+// when the queue is full is the overflow policy given to log_sys_start().
+// Dropped messages are counted and reported to syslog once there is room.
+//
+// Before log_sys_start() and after log_sys_stop() log_sys() is synchronous
+// as before.
+//
+// log_sysf() goes further and leaves the formatting to the writer as well.
+// The caller only stores its format id and the raw argument bytes in the
+// cell, so a double costs a copy instead of a call into printf. The writer
+// walks the format and hands each conversion its argument at the type the
+// conversion names.
+//
+// A run used to clear /var/log/syslog with system() (which needed chmod on
+// a system file), log `uname -a` through popen(), and at the end sleep,
+// copy the syslog with cp and strip its first line with sed, picking up
+// every other process's messages on the way. log_run_open() instead creates
+// syslog-prog-<course>.<assignment>.txt for this run alone, preallocates
+// and maps it, and writes a run header of uname(2), CPU configuration and
+// clock resolutions. While it is open, log_sys() lines go into the mapping
+// in the same format the copied syslog had, by memcpy with no system call,
+// and log_run_close() trims the file to what was written. A run that
+// outgrows the mapping carries on with pwrite() past its end, a system
+// call per line but nothing lost, as the copied syslog never truncated
+// either. Nothing here runs a shell.
+//
+// log_run_open_compact() writes the run log in the binary form of clog.c
+// instead, about a tenth of the size. The writer then hands log_sysf()
+// messages over unformatted, which also saves it the printf work, and
+// clogcat turns the file back into the text lines.
+
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <syslog.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/sysinfo.h>
+#include <sys/utsname.h>
+#include <sys/un.h>
+#include "sys_logger.h"
+#include "clog.h"
+#include "rt_time.h"
 
-// Log a message to the syslog with course number and assignment number
-// Example format: 
-// <System Time> <Host Name> [COURSE:1][ASSIGNMENT:2]: <msg>
-void log_sys(const char *msg, int course_num, int assignment_num) {
-    openlog("pthread", LOG_PID, LOG_USER);
+#define LOG_QUEUE_DEPTH (256)       // must be a power of 2
+#define LOG_QUEUE_MASK (LOG_QUEUE_DEPTH - 1)
+#define LOG_MSG_MAX (256)           // longer messages are truncated
+#define LOG_BATCH_MAX (32)          // datagrams per sendmmsg()
+#define LOG_FLUSH_PERIOD_US (5000)
+#define LOG_SYS_IDENT "pthread"
+#define LOG_SYS_PRI (LOG_USER | LOG_INFO)
+#define RUN_LOG_SIZE (4 * 1024 * 1024)  // preallocated and mapped, lines past this are written
+
+// One queued message, formatted by the writer
+typedef struct
+{
+    atomic_ullong seq;              // cell turn, as in offload_pool.c
+    struct timespec ts;             // CLOCK_REALTIME when log_sys() was called
+    int course;
+    int assignment;
+    unsigned int fmt_id;            // 0 for a text message, else log_fmt index + 1
+    log_arg_t args[LOG_FMT_MAX_ARGS];
+    char msg[LOG_MSG_MAX];
+} log_cell_t;
+
+// Every log_sysf() call site's format, placed by the linker. Weak so a
+// program with no call sites still links.
+extern const log_fmt_t __start_log_fmt[] __attribute__((weak));
+extern const log_fmt_t __stop_log_fmt[] __attribute__((weak));
+
+static log_cell_t cells[LOG_QUEUE_DEPTH];
+static atomic_ullong enqueue_pos;
+static atomic_ullong dequeue_pos;
+static sem_t writer_wake;
+static atomic_int started;
+static atomic_int stopping;
+static log_overflow_t overflow_policy;
+static pthread_t writer_thread;
+static int log_sock = -1;
+
+// Statistics, the atomics are updated by callers
+static atomic_ullong queued;
+static atomic_ullong dropped;
+static unsigned long long sent, send_errors, batches, max_batch, drops_reported;
+
+// Run log file, mapped while open
+static char *run_map;
+static size_t run_size;
+static atomic_size_t run_used;
+static atomic_ullong run_overflow;          // lines past the mapping, written with pwrite()
+static atomic_ullong run_lost;              // lines a failed pwrite() lost
+static int run_fd = -1;
+static char run_path[100];
+static char run_host[65];
+static int run_clog;                        // the run log is a clog file
+
+// Open and connect the datagram socket syslog() itself would use
+static int connect_log_socket(void) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+    if (log_sock < 0)
+        log_sock = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (log_sock < 0)
+        return -1;
+
+    strncpy(addr.sun_path, _PATH_LOG, sizeof(addr.sun_path) - 1);
+    return connect(log_sock, (struct sockaddr *)&addr, sizeof(addr));
+}
+
+// Synchronous path, one round trip to the syslog daemon per message
+static void log_sys_sync(const char *msg, int course_num, int assignment_num) {
+    openlog(LOG_SYS_IDENT, LOG_PID, LOG_USER);
 
     syslog(LOG_INFO, "[COURSE:%d][ASSIGNMENT:%d]: %s", 
             course_num,
@@ -25,86 +145,623 @@ void log_sys(const char *msg, int course_num, int assignment_num) {
     closelog();
 }
 
-// Log machine info to the syslog
-void log_uname(int course, int assignment) {
-    // Construct the command to send to the console
-    FILE *uname_command = popen("uname -a", "r");
-    if (uname_command == NULL) {
-        perror("popen");
-        return;
-    }
+// Format one run log line as the copied syslog had it:
+// 2023-12-06T05:34:01.156232-06:00 host pthread[pid]: text
+static int format_run_line(char *buf, size_t size, const struct timespec *ts, const char *text) {
+    struct tm tm;
+    char stamp[32], zone[8];
+    int len = strlen(text);
 
-    char uname_output[256]; // Stores the output of the uname_command
-    size_t len = 0;
+    // One line per message, as syslogd drops the newline callers often end with
+    while (len > 0 && text[len - 1] == '\n')
+        len--;
+
+    localtime_r(&ts->tv_sec, &tm);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &tm);
+    strftime(zone, sizeof(zone), "%z", &tm);
+    return snprintf(buf, size, "%s.%06ld%.3s:%s %s %s[%d]: %.*s\n", stamp, ts->tv_nsec / 1000,
+                    zone, zone + 3, run_host, LOG_SYS_IDENT, (int)getpid(), len, text);
+}
 
-    while (fgets(uname_output, sizeof(uname_output), uname_command) != NULL) {
-        // Remove the newline character from the uname output
-        len = strlen(uname_output);
-        if (len > 0 && uname_output[len - 1] == '\n') {
-            uname_output[len - 1] = '\0';
+// Reserve room in the file and copy a line in, any thread may call this.
+// Inside the mapping it is a memcpy, past it the rest goes out with pwrite()
+// at the reserved offset, which grows the file.
+static void run_append(const char *line, size_t len) {
+    size_t off = atomic_fetch_add_explicit(&run_used, len, memory_order_relaxed);
+    size_t mapped = 0;
+    ssize_t rc;
+
+    if (off < run_size) {
+        mapped = (off + len <= run_size) ? len : run_size - off;
+        memcpy(run_map + off, line, mapped);
+        if (mapped == len)
+            return;
+    }
+
+    atomic_fetch_add_explicit(&run_overflow, 1, memory_order_relaxed);
+    while (mapped < len) {
+        rc = pwrite(run_fd, line + mapped, len - mapped, off + mapped);
+        if (rc <= 0) {
+            atomic_fetch_add_explicit(&run_lost, 1, memory_order_relaxed);
+            return;
         }
-        // Log the output of the uname command to the syslog
-        log_sys(uname_output, course, assignment);
+        mapped += rc;
     }
+}
+
+// Synchronous write of one message into the run log
+static void run_log_sync(const char *msg, int course_num, int assignment_num) {
+    char body[LOG_MSG_MAX + 32], line[LOG_MSG_MAX + 128];
+    struct timespec now;
+    int len;
 
-    pclose(uname_command);
+    clock_gettime(CLOCK_REALTIME, &now);
+    snprintf(body, sizeof(body), "[COURSE:%d][ASSIGNMENT:%d]: %s", course_num, assignment_num, msg);
+    len = format_run_line(line, sizeof(line), &now, body);
+    run_append(line, (len < (int)sizeof(line)) ? (size_t)len : sizeof(line) - 1);
 }
 
-void remove_first_line(const char *filename) {
-    char command[256]; // stores sed command
+// Claim a cell and copy the message or the format id and arguments in,
+// returns -1 when the queue is full
+static int log_enqueue(const char *msg, const log_fmt_t *fmt, const log_arg_t *args,
+                       int course_num, int assignment_num) {
+    unsigned long long pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+    log_cell_t *cell;
+    long long diff;
 
-    // Construct the `sed` command to remove the first line in the file
-    snprintf(command, sizeof(command), "sed -i '1d' %s", filename);
+    for (;;) {
+        cell = &cells[pos & LOG_QUEUE_MASK];
+        diff = (long long)atomic_load_explicit(&cell->seq, memory_order_acquire) - (long long)pos;
 
-    // Execute the `sed` command using the system function
-    int status = system(command);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return -1;
+        } else {
+            pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+        }
+    }
 
-    // Check status and print error if necessary
-    if (status == -1) {
-        perror("Error running the 'sed' command");
+    clock_gettime(CLOCK_REALTIME, &cell->ts);
+    cell->course = course_num;
+    cell->assignment = assignment_num;
+    if (fmt != NULL) {
+        cell->fmt_id = (fmt - __start_log_fmt) + 1;
+        memcpy(cell->args, args, sizeof(log_arg_t) * fmt->nargs);
     } else {
-        printf("Removed the first line from %s\n", filename);
+        cell->fmt_id = 0;
+        strncpy(cell->msg, msg, LOG_MSG_MAX - 1);
+        cell->msg[LOG_MSG_MAX - 1] = '\0';
     }
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+
+    // Only wake the writer early when the queue is filling up
+    if (pos - atomic_load_explicit(&dequeue_pos, memory_order_relaxed) == LOG_QUEUE_DEPTH / 2)
+        sem_post(&writer_wake);
+
+    return 0;
 }
 
+// Log a message to the syslog with course number and assignment number
+// Example format: 
+// <System Time> <Host Name> [COURSE:1][ASSIGNMENT:2]: <msg>
+void log_sys(const char *msg, int course_num, int assignment_num) {
+    if (!atomic_load_explicit(&started, memory_order_acquire)) {
+        if (run_clog) {
+            struct timespec now;
 
-// Empties the syslog 
-void clear_syslog() {
-    // Note: permissions on the syslog must be 664 
-    // (i.e. chmod 664 /var/log/syslog) 
-    int status = system("sh -c 'echo > /var/log/syslog'");
+            clock_gettime(CLOCK_REALTIME, &now);
+            clog_text(&now, course_num, assignment_num, msg);
+        } else if (run_map != NULL)
+            run_log_sync(msg, course_num, assignment_num);
+        else
+            log_sys_sync(msg, course_num, assignment_num);
+        return;
+    }
 
-    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
-        printf("Syslog cleared successfully.\n");
-    } else {
-        printf("Failed to clear syslog.\n");
+    while (log_enqueue(msg, NULL, NULL, course_num, assignment_num) != 0) {
+        if (overflow_policy == LOG_OVERFLOW_DROP) {
+            atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+            return;
+        }
+        sem_post(&writer_wake);
+        sched_yield();
     }
+
+    atomic_fetch_add_explicit(&queued, 1, memory_order_relaxed);
 }
 
-// Copies the syslog to the current assignment directory
-void copy_syslog(int course, int assignment) {
-    char filename[100]; 
+// Read an argument back at the type a conversion names
+#define LOG_ARG_AS(type, arg) ({ type log_arg_t_v; memcpy(&log_arg_t_v, &(arg), sizeof(log_arg_t_v)); log_arg_t_v; })
 
-    // Wait 1 second to give threads time to complete before copying
-    sleep(1);
-    // Format the filename based on course and assignment
-    snprintf(filename, sizeof(filename), "syslog-prog-%d.%d.txt", course, assignment);
+// Format a log_sysf() message, one snprintf() per conversion
+void log_format_args(char *buf, size_t size, const log_fmt_t *fmt, const log_arg_t *args) {
+    const char *p = fmt->fmt, *conv;
+    char spec[32];
+    size_t out = 0, n;
+    log_arg_t arg;
+    int a = 0, rc, longs;
 
-    // Use the system command to copy syslog to the specified filename
-    int status = system("cp /var/log/syslog .");  // Copy syslog to current directory
+    while (*p != '\0' && out < size - 1) {
+        if (*p != '%' || p[1] == '%') {
+            buf[out++] = *p;
+            p += (*p == '%') ? 2 : 1;
+            continue;
+        }
 
-    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
-        printf("Syslog copied to current directory successfully.\n");
-        // Rename the copied syslog file
-        int rename_status = rename("syslog", filename);
-        if (rename_status == 0) {
-            printf("Renamed to %s.\n", filename);
-        } else {
-            printf("Failed to rename the copied syslog file.\n");
+        // Flags, width, precision and length, then the conversion
+        conv = p + 1 + strspn(p + 1, "-+ #0123456789.hlLqjzt");
+        n = conv - p + 1;
+        if (*conv == '\0' || n >= sizeof(spec))
+            break;
+        memcpy(spec, p, n);
+        spec[n] = '\0';
+        p = conv + 1;
+
+        arg = (a < fmt->nargs) ? args[a++] : 0;
+        longs = (strchr(spec, 'l') != NULL) + (strstr(spec, "ll") != NULL) +
+                2 * (strpbrk(spec, "qjzt") != NULL);
+
+        switch (*conv) {
+        case 'd': case 'i':
+            rc = (longs >= 2) ? snprintf(buf + out, size - out, spec, LOG_ARG_AS(long long, arg)) :
+                 (longs == 1) ? snprintf(buf + out, size - out, spec, LOG_ARG_AS(long, arg)) :
+                                snprintf(buf + out, size - out, spec, LOG_ARG_AS(int, arg));
+            break;
+        case 'u': case 'o': case 'x': case 'X': case 'c':
+            rc = (longs >= 2) ? snprintf(buf + out, size - out, spec, LOG_ARG_AS(unsigned long long, arg)) :
+                 (longs == 1) ? snprintf(buf + out, size - out, spec, LOG_ARG_AS(unsigned long, arg)) :
+                                snprintf(buf + out, size - out, spec, LOG_ARG_AS(unsigned int, arg));
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            rc = snprintf(buf + out, size - out, spec, LOG_ARG_AS(double, arg));
+            break;
+        case 's':
+            rc = snprintf(buf + out, size - out, spec, LOG_ARG_AS(const char *, arg));
+            break;
+        case 'p':
+            rc = snprintf(buf + out, size - out, spec, LOG_ARG_AS(void *, arg));
+            break;
+        default:
+            rc = snprintf(buf + out, size - out, "%s", spec);
+            break;
         }
-        // Remove first line of the syslog always inserted by the syslog daemon
-        remove_first_line(filename);
-    } else {
-        printf("Failed to copy syslog.\n");
+        if (rc < 0)
+            break;
+        out += ((size_t)rc < size - out) ? (size_t)rc : size - out - 1;
+    }
+
+    buf[out] = '\0';
+}
+
+// Queue a log_sysf() call site's id and arguments, formatted right away until log_sys_start()
+void log_sys_args(const log_fmt_t *fmt, int course_num, int assignment_num, const log_arg_t *args) {
+    char msg[LOG_MSG_MAX];
+
+    if (!atomic_load_explicit(&started, memory_order_acquire)) {
+        if (run_clog) {
+            struct timespec now;
+
+            clock_gettime(CLOCK_REALTIME, &now);
+            clog_fmt(&now, course_num, assignment_num, (fmt - __start_log_fmt) + 1, fmt, args);
+            return;
+        }
+        log_format_args(msg, sizeof(msg), fmt, args);
+        log_sys(msg, course_num, assignment_num);
+        return;
+    }
+
+    while (log_enqueue(NULL, fmt, args, course_num, assignment_num) != 0) {
+        if (overflow_policy == LOG_OVERFLOW_DROP) {
+            atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+            return;
+        }
+        sem_post(&writer_wake);
+        sched_yield();
+    }
+
+    atomic_fetch_add_explicit(&queued, 1, memory_order_relaxed);
+}
+
+// Format strings registered by log_sysf() call sites
+int log_fmt_count(void) {
+    return (__start_log_fmt != NULL) ? (int)(__stop_log_fmt - __start_log_fmt) : 0;
+}
+
+// Format one message as syslog() would: <pri>Mmm dd hh:mm:ss ident[pid]: text
+static int format_message(char *buf, size_t size, const struct timespec *ts, const char *text) {
+    struct tm tm;
+    char stamp[32];
+
+    localtime_r(&ts->tv_sec, &tm);
+    strftime(stamp, sizeof(stamp), "%b %e %T", &tm);
+    return snprintf(buf, size, "<%d>%s %s[%d]: %s", LOG_SYS_PRI, stamp, LOG_SYS_IDENT, (int)getpid(), text);
+}
+
+// Send one batch of formatted datagrams, reconnecting once if syslogd was restarted
+static void send_batch(struct mmsghdr *msgs, int count) {
+    int done = 0, rc, retried = 0;
+
+    while (done < count) {
+        rc = sendmmsg(log_sock, msgs + done, count - done, 0);
+        if (rc < 0) {
+            if (!retried && (errno == ECONNREFUSED || errno == ENOTCONN) && connect_log_socket() == 0) {
+                retried = 1;
+                continue;
+            }
+            send_errors += count - done;
+            break;
+        }
+        done += rc;
+    }
+
+    sent += done;
+    batches++;
+    if ((unsigned long long)count > max_batch)
+        max_batch = count;
+}
+
+// Format for whichever sink is open, the run log or the syslog socket
+static int format_entry(char *buf, size_t size, const struct timespec *ts, const char *text) {
+    if (run_map != NULL)
+        return format_run_line(buf, size, ts, text);
+    return format_message(buf, size, ts, text);
+}
+
+// Batch for a clog run log, messages are encoded as queued and never formatted here
+static int flush_compact(void) {
+    unsigned long long pos = atomic_load_explicit(&dequeue_pos, memory_order_relaxed);
+    unsigned long long lost;
+    struct timespec now;
+    char body[LOG_MSG_MAX];
+    log_cell_t *cell;
+    int count = 0;
+
+    lost = atomic_load_explicit(&dropped, memory_order_relaxed) - drops_reported;
+    if (lost > 0) {
+        drops_reported += lost;
+        clock_gettime(CLOCK_REALTIME, &now);
+        snprintf(body, sizeof(body), "log_sys: queue full, %llu messages dropped", lost);
+        clog_text(&now, 0, 0, body);
+        count++;
+    }
+
+    while (count < LOG_BATCH_MAX) {
+        cell = &cells[pos & LOG_QUEUE_MASK];
+        if ((long long)atomic_load_explicit(&cell->seq, memory_order_acquire) - (long long)(pos + 1) != 0)
+            break;
+
+        if (cell->fmt_id != 0)
+            clog_fmt(&cell->ts, cell->course, cell->assignment, cell->fmt_id,
+                     &__start_log_fmt[cell->fmt_id - 1], cell->args);
+        else
+            clog_text(&cell->ts, cell->course, cell->assignment, cell->msg);
+        count++;
+
+        atomic_store_explicit(&cell->seq, pos + LOG_QUEUE_DEPTH, memory_order_release);
+        pos++;
+    }
+    atomic_store_explicit(&dequeue_pos, pos, memory_order_relaxed);
+
+    if (count > 0) {
+        sent += count;
+        batches++;
+        if ((unsigned long long)count > max_batch)
+            max_batch = count;
+    }
+    return count;
+}
+
+// Take up to a batch of messages off the queue and send them, returns how many were taken
+static int flush_batch(void) {
+    static char text[LOG_BATCH_MAX][LOG_MSG_MAX + 64];
+    static char body[LOG_MSG_MAX + 32];
+    static char msg[LOG_MSG_MAX];
+    struct mmsghdr msgs[LOG_BATCH_MAX];
+    struct iovec iov[LOG_BATCH_MAX];
+    unsigned long long pos = atomic_load_explicit(&dequeue_pos, memory_order_relaxed);
+    unsigned long long lost;
+    log_cell_t *cell;
+    int count = 0, len;
+
+    if (run_clog)
+        return flush_compact();
+
+    // Report drops first, so the gap shows where it happened
+    lost = atomic_load_explicit(&dropped, memory_order_relaxed) - drops_reported;
+    if (lost > 0) {
+        drops_reported += lost;
+        struct timespec now;
+
+        clock_gettime(CLOCK_REALTIME, &now);
+        snprintf(body, sizeof(body), "log_sys: queue full, %llu messages dropped", lost);
+        len = format_entry(text[count], sizeof(text[count]), &now, body);
+        iov[count].iov_base = text[count];
+        iov[count].iov_len = (len < (int)sizeof(text[count])) ? (size_t)len : sizeof(text[count]) - 1;
+        count++;
     }
-}
\ No newline at end of file
+
+    while (count < LOG_BATCH_MAX) {
+        cell = &cells[pos & LOG_QUEUE_MASK];
+        if ((long long)atomic_load_explicit(&cell->seq, memory_order_acquire) - (long long)(pos + 1) != 0)
+            break;
+
+        if (cell->fmt_id != 0)
+            log_format_args(msg, sizeof(msg), &__start_log_fmt[cell->fmt_id - 1], cell->args);
+        snprintf(body, sizeof(body), "[COURSE:%d][ASSIGNMENT:%d]: %s", cell->course, cell->assignment,
+                 (cell->fmt_id != 0) ? msg : cell->msg);
+        len = format_entry(text[count], sizeof(text[count]), &cell->ts, body);
+        iov[count].iov_base = text[count];
+        iov[count].iov_len = (len < (int)sizeof(text[count])) ? (size_t)len : sizeof(text[count]) - 1;
+        count++;
+
+        // Hand the cell back to the producers
+        atomic_store_explicit(&cell->seq, pos + LOG_QUEUE_DEPTH, memory_order_release);
+        pos++;
+    }
+    atomic_store_explicit(&dequeue_pos, pos, memory_order_relaxed);
+
+    if (count == 0)
+        return 0;
+
+    // The run log takes the batch with one copy per line
+    if (run_map != NULL) {
+        for (len = 0; len < count; len++)
+            run_append(iov[len].iov_base, iov[len].iov_len);
+        sent += count;
+        batches++;
+        if ((unsigned long long)count > max_batch)
+            max_batch = count;
+        return count;
+    }
+
+    memset(msgs, 0, sizeof(msgs[0]) * count);
+    for (len = 0; len < count; len++) {
+        msgs[len].msg_hdr.msg_iov = &iov[len];
+        msgs[len].msg_hdr.msg_iovlen = 1;
+    }
+    send_batch(msgs, count);
+
+    return count;
+}
+
+static void *log_writer(void *arg) {
+    struct timespec deadline;
+
+    for (;;) {
+        while (flush_batch() == LOG_BATCH_MAX)
+            ;
+        if (atomic_load(&stopping))
+            break;
+
+        deadline = rt_time_to_ts(rt_time_real() + LOG_FLUSH_PERIOD_US * RT_NSEC_PER_USEC);
+        sem_timedwait(&writer_wake, &deadline);
+    }
+
+    // Everything queued before the stop is sent
+    while (flush_batch() > 0)
+        ;
+
+    return NULL;
+}
+
+// Switch log_sys() to the queue and writer thread. The writer runs
+// SCHED_OTHER on the cores not in rt_cpus.
+int log_sys_start(const cpu_set_t *rt_cpus, log_overflow_t overflow) {
+    pthread_attr_t attr;
+    struct sched_param param;
+    cpu_set_t writer_cpus;
+    int i, rc;
+
+    // The socket is only needed when there is no run log to write to
+    if (run_map == NULL && !run_clog && connect_log_socket() != 0) {
+        perror("log_sys connect " _PATH_LOG);
+        return -1;
+    }
+
+    for (i = 0; i < LOG_QUEUE_DEPTH; i++)
+        atomic_init(&cells[i].seq, i);
+    atomic_store(&enqueue_pos, 0);
+    atomic_store(&dequeue_pos, 0);
+    atomic_store(&stopping, 0);
+    overflow_policy = overflow;
+    if (sem_init(&writer_wake, 0, 0)) {
+        printf("Failed to initialize log_sys semaphore\n");
+        return -1;
+    }
+
+    CPU_ZERO(&writer_cpus);
+    for (i = 0; i < get_nprocs(); i++)
+        if (rt_cpus == NULL || !CPU_ISSET(i, rt_cpus))
+            CPU_SET(i, &writer_cpus);
+    if (CPU_COUNT(&writer_cpus) == 0)
+        for (i = 0; i < get_nprocs(); i++)
+            CPU_SET(i, &writer_cpus);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+    param.sched_priority = 0;
+    pthread_attr_setschedparam(&attr, &param);
+    pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &writer_cpus);
+
+    rc = pthread_create(&writer_thread, &attr, log_writer, NULL);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        printf("pthread_create for log_sys writer failed: %s\n", strerror(rc));
+        return -1;
+    }
+
+    atomic_store_explicit(&started, 1, memory_order_release);
+    return 0;
+}
+
+// Send everything still queued and go back to synchronous logging.
+// Call once the threads that log are done.
+void log_sys_stop(void) {
+    if (!atomic_load(&started))
+        return;
+
+    atomic_store(&started, 0);
+    atomic_store(&stopping, 1);
+    sem_post(&writer_wake);
+    pthread_join(writer_thread, NULL);
+    sem_destroy(&writer_wake);
+
+    if (log_sock >= 0)
+        close(log_sock);
+    log_sock = -1;
+}
+
+void log_sys_report(void) {
+    printf("log_sys: queued=%llu sent=%llu dropped=%llu send errors=%llu in %llu batches (max %llu), %d formats\n",
+           atomic_load(&queued), sent, atomic_load(&dropped), send_errors, batches, max_batch, log_fmt_count());
+    if (run_fd >= 0)
+        printf("log_sys: run log %s %zu bytes, %zu mapped, %llu lines written past the mapping, %llu lost\n",
+               run_path, atomic_load(&run_used), run_size, atomic_load(&run_overflow), atomic_load(&run_lost));
+}
+
+// Log machine info to the syslog, from uname(2) in the layout of uname -a
+void log_uname(int course, int assignment) {
+    struct utsname un;
+    char uname_output[sizeof(un) + 8];
+
+    if (uname(&un) != 0) {
+        perror("uname");
+        return;
+    }
+
+    snprintf(uname_output, sizeof(uname_output), "%s %s %s %s %s",
+             un.sysname, un.nodename, un.release, un.version, un.machine);
+    log_sys(uname_output, course, assignment);
+}
+
+// Log the CPUs configured, online and usable by this process
+static void log_cpu_config(int course, int assignment) {
+    char msg[LOG_MSG_MAX];
+    cpu_set_t cpuset;
+    int i, len;
+
+    len = snprintf(msg, sizeof(msg), "CPUs configured=%d online=%d affinity=", get_nprocs_conf(), get_nprocs());
+    if (sched_getaffinity(0, sizeof(cpuset), &cpuset) == 0) {
+        for (i = 0; i < CPU_SETSIZE && len < (int)sizeof(msg) - 8; i++)
+            if (CPU_ISSET(i, &cpuset))
+                len += snprintf(msg + len, sizeof(msg) - len, "%d,", i);
+        if (msg[len - 1] == ',')
+            msg[len - 1] = '\0';
+    }
+    log_sys(msg, course, assignment);
+}
+
+// Log the resolution of the clocks the sequencer and services use
+static void log_clock_res(int course, int assignment) {
+    struct timespec rt_res, mono_res, raw_res;
+    char msg[LOG_MSG_MAX];
+
+    clock_getres(CLOCK_REALTIME, &rt_res);
+    clock_getres(CLOCK_MONOTONIC, &mono_res);
+    clock_getres(CLOCK_MONOTONIC_RAW, &raw_res);
+    snprintf(msg, sizeof(msg), "Clock resolution REALTIME=%lld ns MONOTONIC=%lld ns MONOTONIC_RAW=%lld ns",
+             (long long)rt_time_from_ts(&rt_res), (long long)rt_time_from_ts(&mono_res),
+             (long long)rt_time_from_ts(&raw_res));
+    log_sys(msg, course, assignment);
+}
+
+// Create this run's log file, preallocated and mapped, and write the run header.
+// Replaces clearing the syslog at the start of a run.
+int log_run_open(int course, int assignment) {
+    struct utsname un;
+    int rc;
+
+    snprintf(run_path, sizeof(run_path), "syslog-prog-%d.%d.txt", course, assignment);
+    run_fd = open(run_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (run_fd < 0) {
+        perror("log_run open");
+        return -1;
+    }
+
+    // Reserve the blocks now so appending never allocates in the file system
+    run_size = RUN_LOG_SIZE;
+    rc = posix_fallocate(run_fd, 0, run_size);
+    if (rc != 0 && ftruncate(run_fd, run_size) != 0) {
+        perror("log_run preallocate");
+        close(run_fd);
+        run_fd = -1;
+        return -1;
+    }
+
+    run_map = mmap(NULL, run_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, run_fd, 0);
+    if (run_map == MAP_FAILED) {
+        perror("log_run mmap");
+        run_map = NULL;
+        close(run_fd);
+        run_fd = -1;
+        return -1;
+    }
+    atomic_store(&run_used, 0);
+    atomic_store(&run_overflow, 0);
+    atomic_store(&run_lost, 0);
+
+    if (uname(&un) == 0)
+        snprintf(run_host, sizeof(run_host), "%s", un.nodename);
+
+    // Run header
+    log_uname(course, assignment);
+    log_cpu_config(course, assignment);
+    log_clock_res(course, assignment);
+
+    printf("Run log %s opened.\n", run_path);
+    return 0;
+}
+
+// Create this run's log as syslog-prog-<course>.<assignment>.clog and write the run header
+int log_run_open_compact(int course, int assignment) {
+    struct utsname un;
+
+    snprintf(run_path, sizeof(run_path), "syslog-prog-%d.%d.clog", course, assignment);
+    if (uname(&un) == 0)
+        snprintf(run_host, sizeof(run_host), "%s", un.nodename);
+    if (clog_open(run_path, run_host, LOG_SYS_IDENT, log_fmt_count()))
+        return -1;
+    run_clog = 1;
+
+    // Run header
+    log_uname(course, assignment);
+    log_cpu_config(course, assignment);
+    log_clock_res(course, assignment);
+
+    printf("Run log %s opened.\n", run_path);
+    return 0;
+}
+
+// Trim the run log to what was written and close it. Call after log_sys_stop().
+// Replaces copying the syslog at the end of a run.
+void log_run_close(void) {
+    size_t used = atomic_load(&run_used);
+
+    if (run_clog) {
+        clog_close();
+        run_clog = 0;
+        clog_report();
+        return;
+    }
+
+    if (run_map == NULL)
+        return;
+
+    msync(run_map, (used < run_size) ? used : run_size, MS_SYNC);
+    munmap(run_map, run_size);
+    run_map = NULL;
+
+    if (ftruncate(run_fd, used) != 0)
+        perror("log_run trim");
+    close(run_fd);
+    run_fd = -1;
+
+    printf("Run log written to %s, %zu bytes.\n", run_path, used);
+    if (atomic_load(&run_overflow) > 0)
+        printf("Run log outgrew its %zu byte mapping, %llu lines written with pwrite, %llu lost.\n",
+               run_size, atomic_load(&run_overflow), atomic_load(&run_lost));
+}
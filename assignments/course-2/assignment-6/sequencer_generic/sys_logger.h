@@ -1,9 +1,86 @@
 #ifndef SYSLOGGER_H
 #define SYSLOGGER_H
 
+// cpu_set_t needs _GNU_SOURCE defined before the first system include
+#include <sched.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+// What log_sys() does when the queue to the writer thread is full
+typedef enum
+{
+    LOG_OVERFLOW_DROP,      // drop the message and count it, the caller never waits (default)
+    LOG_OVERFLOW_WAIT       // yield until there is room, only for non-RT callers
+} log_overflow_t;
+
 void log_sys(const char *msg, int course_num, int assignment_num);
+
+// Deferred formatting. log_sysf() keeps the format's id and the raw bytes
+// of up to LOG_FMT_MAX_ARGS arguments, the writer thread formats the line.
+// Each call site's format is a static log_fmt_t the linker gathers into the
+// log_fmt section, the id is its index there. Arguments are integers,
+// pointers or doubles; %s only for strings that outlive the run, such as
+// literals. At least one argument, use log_sys() for fixed text.
+#define LOG_FMT_MAX_ARGS (6)
+
+typedef uint64_t log_arg_t;
+
+typedef struct
+{
+    const char *fmt;
+    const char *file;
+    int line;
+    int nargs;
+} log_fmt_t;
+
+void log_sys_args(const log_fmt_t *fmt, int course_num, int assignment_num, const log_arg_t *args);
+int log_fmt_count(void);
+
+// Format a deferred message as the writer does, also for tools that read them back
+void log_format_args(char *buf, size_t size, const log_fmt_t *fmt, const log_arg_t *args);
+
+#define log_sysf(course, assignment, format, ...) do {                                    \
+        static const log_fmt_t log_fmt_site                                              \
+            __attribute__((section("log_fmt"), used, aligned(8))) =                      \
+            { format, __FILE__, __LINE__, LOG_FMT_NARGS(__VA_ARGS__) };                  \
+        if (0) printf(format, __VA_ARGS__);         /* format checks only, never runs */ \
+        log_sys_args(&log_fmt_site, course, assignment,                                  \
+                     (const log_arg_t[]){ LOG_FMT_ARGS(LOG_FMT_NARGS(__VA_ARGS__), __VA_ARGS__) }); \
+    } while (0)
+
+// Argument count and capture, the arguments promoted as printf() would see them
+#define LOG_FMT_NARGS(...) LOG_FMT_NARGS_(__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_FMT_NARGS_(a1, a2, a3, a4, a5, a6, n, ...) n
+
+#define LOG_FMT_ARG(x) ({                                                                  \
+        __typeof__((x) + 0) log_arg_v = (x);                                              \
+        log_arg_t log_arg_raw = 0;                                                         \
+        _Static_assert(sizeof(log_arg_v) <= sizeof(log_arg_t) &&                           \
+                       !__builtin_types_compatible_p(__typeof__(log_arg_v), float),        \
+                       "log_sysf arguments must be integers, pointers or double");         \
+        memcpy(&log_arg_raw, &log_arg_v, sizeof(log_arg_v));                               \
+        log_arg_raw; })
+
+#define LOG_FMT_ARGS(n, ...) LOG_FMT_ARGS_(n, __VA_ARGS__)
+#define LOG_FMT_ARGS_(n, ...) LOG_FMT_ARGS_##n(__VA_ARGS__)
+#define LOG_FMT_ARGS_1(a) LOG_FMT_ARG(a)
+#define LOG_FMT_ARGS_2(a, ...) LOG_FMT_ARG(a), LOG_FMT_ARGS_1(__VA_ARGS__)
+#define LOG_FMT_ARGS_3(a, ...) LOG_FMT_ARG(a), LOG_FMT_ARGS_2(__VA_ARGS__)
+#define LOG_FMT_ARGS_4(a, ...) LOG_FMT_ARG(a), LOG_FMT_ARGS_3(__VA_ARGS__)
+#define LOG_FMT_ARGS_5(a, ...) LOG_FMT_ARG(a), LOG_FMT_ARGS_4(__VA_ARGS__)
+#define LOG_FMT_ARGS_6(a, ...) LOG_FMT_ARG(a), LOG_FMT_ARGS_5(__VA_ARGS__)
 void log_uname(int course_num, int assignment_num);
-void clear_syslog();
-void copy_syslog(int course, int assignment);
+
+// Per-run log file, syslog-prog-<course>.<assignment>.txt, or .clog in the
+// compact binary form of clog.h
+int log_run_open(int course, int assignment);
+int log_run_open_compact(int course, int assignment);
+void log_run_close(void);
+
+// Asynchronous backend for log_sys(), synchronous until started
+int log_sys_start(const cpu_set_t *rt_cpus, log_overflow_t overflow);
+void log_sys_stop(void);
+void log_sys_report(void);
 
 #endif
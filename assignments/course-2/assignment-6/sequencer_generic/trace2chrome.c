@@ -0,0 +1,257 @@
+/**
+ * File: trace2chrome.c
+ * Author: Brad Waggle
+ * Description: Converts a trace_ring binary trace to Chrome Trace Event
+ *              JSON for chrome://tracing or ui.perfetto.dev.
+ * Date: October 18, 2026
+ */
+
+// Replaces drawing the timing diagrams by hand from syslog. Each service
+// gets a track with one slice per release it ran, from its start to its
+// completion and numbered like that release, and instant markers for the
+// release, preemption, deadline misses and overruns. With -c every slice
+// is also put on a track for the core it ran on. Timestamps are
+// microseconds from trace_start(). Flight recorder snapshots are read the
+// same way.
+//
+// The input is read a block of records at a time and every record is
+// written out as soon as it is read, so memory use does not grow with the
+// trace. Records are only in order per thread, but a start and its
+// completion come from the same thread, so pairing them needs nothing more
+// than the last start of each service. The viewers sort by time on load.
+//
+// A multi-minute run is still a large JSON file, -w keeps only a window of
+// it. Usage: trace2chrome [-c] [-w from_ms:to_ms] trace.bin [out.json]
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "trace_ring.h"
+
+// Records read per fread()
+#define BLOCK_RECORDS (4096)
+
+// Service and core ids fit in the record fields
+#define MAX_SVC (65536)
+#define MAX_CPU (1024)
+
+// Track ids: services are pid 1 with tid = service, cores are pid 2 with tid = core
+#define PID_SERVICES 1
+#define PID_CPUS 2
+
+// Last start seen per service, for pairing with its completion
+typedef struct
+{
+    uint64_t ts_ns;
+    uint64_t seq;
+    int valid;
+} svc_start_t;
+
+static svc_start_t starts[MAX_SVC];
+static unsigned char svc_named[MAX_SVC];
+static unsigned char cpu_named[MAX_CPU];
+
+static FILE *out;
+static uint64_t base_ns;
+static unsigned long long events_out;
+
+// Separate events with a comma, the first one opens the array
+static void begin_event(void) {
+    fputs(events_out++ ? ",\n" : "\n", out);
+}
+
+static double usec(uint64_t ts_ns) {
+    return (ts_ns - base_ns) / 1000.0;
+}
+
+static void name_track(int pid, int tid, const char *fmt, int id) {
+    char name[32];
+
+    snprintf(name, sizeof(name), fmt, id);
+    begin_event();
+    fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            pid, tid, name);
+    begin_event();
+    fprintf(out, "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"sort_index\":%d}}",
+            pid, tid, tid);
+}
+
+static void name_service(int svc) {
+    if (svc_named[svc])
+        return;
+    svc_named[svc] = 1;
+    if (svc == 0)
+        name_track(PID_SERVICES, 0, "Sequencer", 0);
+    else
+        name_track(PID_SERVICES, svc, "S%d", svc);
+}
+
+static void name_cpu(unsigned int cpu) {
+    if (cpu >= MAX_CPU || cpu_named[cpu])
+        return;
+    cpu_named[cpu] = 1;
+    name_track(PID_CPUS, cpu, "CPU %d", cpu);
+}
+
+static void instant(const trace_record_t *rec, const char *name, const char *arg_name) {
+    begin_event();
+    fprintf(out, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":%d,\"tid\":%u,"
+            "\"args\":{\"seq\":%llu,\"cpu\":%u",
+            name, usec(rec->ts_ns), PID_SERVICES, rec->svc, (unsigned long long)rec->seq, rec->cpu);
+    if (arg_name != NULL)
+        fprintf(out, ",\"%s\":%llu", arg_name, (unsigned long long)rec->arg);
+    fputs("}}", out);
+}
+
+// One slice from the start to the completion, on the service track and optionally its core
+static void slice(const trace_record_t *rec, int per_cpu) {
+    svc_start_t *start = &starts[rec->svc];
+    uint64_t begin_ns;
+
+    // Fall back to the execution time if the start was dropped or is outside the window
+    if (start->valid && start->seq == rec->seq && start->ts_ns <= rec->ts_ns)
+        begin_ns = start->ts_ns;
+    else
+        begin_ns = (rec->arg < rec->ts_ns - base_ns) ? rec->ts_ns - rec->arg : base_ns;
+    start->valid = 0;
+
+    begin_event();
+    fprintf(out, "{\"name\":\"S%u\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u,"
+            "\"args\":{\"seq\":%llu,\"cpu\":%u,\"exec_us\":%.3f}}",
+            rec->svc, usec(begin_ns), (rec->ts_ns - begin_ns) / 1000.0, PID_SERVICES, rec->svc,
+            (unsigned long long)rec->seq, rec->cpu, rec->arg / 1000.0);
+
+    if (per_cpu && rec->cpu < MAX_CPU) {
+        name_cpu(rec->cpu);
+        begin_event();
+        fprintf(out, "{\"name\":\"S%u\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u,"
+                "\"args\":{\"seq\":%llu}}",
+                rec->svc, usec(begin_ns), (rec->ts_ns - begin_ns) / 1000.0, PID_CPUS, rec->cpu,
+                (unsigned long long)rec->seq);
+    }
+}
+
+static void convert(const trace_record_t *rec, int per_cpu) {
+    name_service(rec->svc);
+
+    switch (rec->event) {
+    case TRACE_EV_RELEASE:
+        instant(rec, "release", NULL);
+        break;
+    case TRACE_EV_START:
+        starts[rec->svc].ts_ns = rec->ts_ns;
+        starts[rec->svc].seq = rec->seq;
+        starts[rec->svc].valid = 1;
+        break;
+    case TRACE_EV_COMPLETE:
+        slice(rec, per_cpu);
+        break;
+    case TRACE_EV_PREEMPTED:
+        instant(rec, "preempted", "switches");
+        break;
+    case TRACE_EV_DEADLINE_MISS:
+        instant(rec, "deadline miss", NULL);
+        break;
+    case TRACE_EV_OVERRUN:
+        instant(rec, "sequencer overrun", "ns over");
+        break;
+    case TRACE_EV_BUDGET:
+        instant(rec, "budget overrun", "exec ns");
+        break;
+    case TRACE_EV_MARK:
+        instant(rec, "mark", "arg");
+        break;
+    default:
+        break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    static trace_record_t block[BLOCK_RECORDS];
+    trace_file_header_t header;
+    unsigned long long records = 0, skipped = 0;
+    double from_ms = 0, to_ms = -1;
+    uint64_t from_ns, to_ns;
+    int opt, per_cpu = 0;
+    size_t i, n;
+    FILE *in;
+
+    while ((opt = getopt(argc, argv, "cw:")) != -1) {
+        switch (opt) {
+        case 'c':
+            per_cpu = 1;
+            break;
+        case 'w':
+            if (sscanf(optarg, "%lf:%lf", &from_ms, &to_ms) != 2 || to_ms < from_ms) {
+                printf("Window must be from_ms:to_ms\n");
+                return -1;
+            }
+            break;
+        default:
+            printf("Usage: %s [-c] [-w from_ms:to_ms] trace.bin [out.json]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (optind >= argc) {
+        printf("Usage: %s [-c] [-w from_ms:to_ms] trace.bin [out.json]\n", argv[0]);
+        return -1;
+    }
+
+    in = fopen(argv[optind], "rb");
+    if (in == NULL) {
+        perror(argv[optind]);
+        return -1;
+    }
+    if (fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+        printf("%s is not a sequencer trace\n", argv[optind]);
+        return -1;
+    }
+    if (header.record_size != sizeof(trace_record_t)) {
+        printf("Record size %u, expected %zu\n", header.record_size, sizeof(trace_record_t));
+        return -1;
+    }
+
+    out = (optind + 1 < argc) ? fopen(argv[optind + 1], "w") : stdout;
+    if (out == NULL) {
+        perror(argv[optind + 1]);
+        return -1;
+    }
+
+    base_ns = header.start_ns;
+    from_ns = base_ns + (uint64_t)(from_ms * 1000000.0);
+    to_ns = (to_ms < 0) ? UINT64_MAX : base_ns + (uint64_t)(to_ms * 1000000.0);
+
+    fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", out);
+    begin_event();
+    fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"Services\"}}", PID_SERVICES);
+    if (per_cpu) {
+        begin_event();
+        fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"CPUs\"}}", PID_CPUS);
+    }
+
+    while ((n = fread(block, sizeof(trace_record_t), BLOCK_RECORDS, in)) > 0) {
+        for (i = 0; i < n; i++) {
+            records++;
+            if (block[i].ts_ns < from_ns || block[i].ts_ns > to_ns || block[i].ts_ns < base_ns) {
+                skipped++;
+                continue;
+            }
+            convert(&block[i], per_cpu);
+        }
+    }
+
+    fputs("\n]}\n", out);
+    fclose(in);
+    if (out != stdout && fclose(out) != 0) {
+        perror("close output");
+        return -1;
+    }
+
+    fprintf(stderr, "%llu records, %llu outside the window, %llu trace events\n", records, skipped, events_out);
+
+    return 0;
+}
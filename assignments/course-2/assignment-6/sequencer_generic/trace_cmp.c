@@ -0,0 +1,459 @@
+/**
+ * File: trace_cmp.c
+ * Author: Brad Waggle
+ * Description: Compares the per-service timing of two or more runs and
+ *              flags the regressions.
+ * Date: October 18, 2026
+ */
+
+// Reads trace_ring files (or flight recorder snapshots), the first one the
+// baseline, and for every service pairs each release with its start and
+// completion by release number. That gives per service:
+//
+//   latency   release to start
+//   response  release to completion
+//   jitter    change in latency from one release to the next
+//   exec      start to completion, as the service measured it
+//   release   how far each release interval is from the service's nominal
+//             period, which is what ABS_DELAY, DRIFT_CONTROL and
+//             CLOCK_BIAS_NANOSEC move
+//
+// The nominal period is the multiple of the sequencer period (from the
+// trace header, or -p for traces without one) nearest to the service's
+// median interval. Without either the baseline's median interval stands
+// in, so a later run whose period changed as a whole still shows it.
+//
+// A release coalesced into a later one (S4 takes every pending eventfd
+// release in one run) has no start or completion of its own and only
+// counts towards the release intervals.
+//
+// Each distribution of a later run is tested against the baseline's with
+// the Mann-Whitney U test (has it shifted?) and the two-sample
+// Kolmogorov-Smirnov test (has its shape changed, tails included?). A
+// difference only counts as a regression when a test says it is real at
+// the -a level and the median or p99 got worse by more than the -m or -t
+// percentage, so noise and harmless shifts stay quiet.
+//
+// A steady drift moves every interval by the same small amount, so each
+// service also gets its mean interval and the cumulative drift of its
+// releases from the nominal period. Drifting by more than -d parts per
+// million over what the baseline drifts is a regression on its own. The
+// exit status is 1 when anything regressed, for scripts that compare
+// builds.
+//
+// Usage: trace_cmp [-a alpha] [-m median_pct] [-t p99_pct] [-d drift_ppm] [-k skip] [-p period_us]
+//                  base.bin run.bin...
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include "trace_ring.h"
+
+#define MAX_SVC (16)
+#define MAX_SEQ (1UL << 26)             // releases kept per service
+#define MIN_SAMPLES (8)                 // fewer and no test is run
+#define BLOCK_RECORDS (4096)
+
+enum { M_LATENCY, M_RESPONSE, M_JITTER, M_EXEC, M_RELEASE, NUM_METRICS };
+
+static const char *metric_names[NUM_METRICS] = { "latency", "response", "jitter", "exec", "release" };
+
+typedef struct
+{
+    double *v;                          // ns, sorted once loaded
+    size_t n, cap;
+} sample_t;
+
+// Event times of one service, by release number
+typedef struct
+{
+    uint64_t *release, *start, *complete, *exec;
+    size_t cap;
+} svc_events_t;
+
+typedef struct
+{
+    const char *path;
+    unsigned long long period_ns;       // sequencer period, 0 if not known
+    sample_t interval[MAX_SVC];         // release intervals, ns
+    double nominal[MAX_SVC];            // the service's release period, ns
+    sample_t metric[MAX_SVC][NUM_METRICS];
+} run_t;
+
+static double alpha = 0.01, median_pct = 10.0, tail_pct = 20.0, drift_ppm = 1000.0;
+static unsigned long long period_ns;
+static unsigned long skip;
+
+static int push(sample_t *s, double v) {
+    double *grown;
+
+    if (s->n == s->cap) {
+        s->cap = s->cap ? s->cap * 2 : 1024;
+        grown = realloc(s->v, s->cap * sizeof(double));
+        if (grown == NULL)
+            return -1;
+        s->v = grown;
+    }
+    s->v[s->n++] = v;
+    return 0;
+}
+
+static double sum(const sample_t *s) {
+    double total = 0;
+    size_t i;
+
+    for (i = 0; i < s->n; i++)
+        total += s->v[i];
+    return total;
+}
+
+static int by_value(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+// Nearest rank on sorted values
+static double percentile(const sample_t *s, double pct) {
+    size_t rank = (size_t)ceil(pct / 100.0 * s->n);
+
+    return s->v[(rank > 0 ? rank : 1) - 1];
+}
+
+static int grow_events(svc_events_t *ev, uint64_t seq) {
+    size_t cap = ev->cap ? ev->cap : 1024;
+    uint64_t **arrays[4] = { &ev->release, &ev->start, &ev->complete, &ev->exec };
+    uint64_t *grown;
+    int i;
+
+    while (cap <= seq)
+        cap *= 2;
+    for (i = 0; i < 4; i++) {
+        grown = realloc(*arrays[i], cap * sizeof(uint64_t));
+        if (grown == NULL)
+            return -1;
+        memset(grown + ev->cap, 0, (cap - ev->cap) * sizeof(uint64_t));
+        *arrays[i] = grown;
+    }
+    ev->cap = cap;
+    return 0;
+}
+
+// Read a trace and turn its events into the samples of every metric
+static int load(run_t *run) {
+    static trace_record_t block[BLOCK_RECORDS];
+    static svc_events_t events[MAX_SVC];
+    trace_file_header_t header;
+    uint64_t prev_release, prev_latency, latency;
+    size_t i, n, seq;
+    int svc, have_prev;
+    FILE *in;
+
+    in = fopen(run->path, "rb");
+    if (in == NULL) {
+        perror(run->path);
+        return -1;
+    }
+    if (fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 ||
+        header.record_size != sizeof(trace_record_t)) {
+        printf("%s is not a sequencer trace of this version\n", run->path);
+        fclose(in);
+        return -1;
+    }
+    run->period_ns = period_ns ? period_ns : header.period_ns;
+
+    for (svc = 0; svc < MAX_SVC; svc++)
+        if (events[svc].cap > 0)
+            for (i = 0; i < events[svc].cap; i++)
+                events[svc].release[i] = events[svc].start[i] = events[svc].complete[i] = events[svc].exec[i] = 0;
+
+    while ((n = fread(block, sizeof(trace_record_t), BLOCK_RECORDS, in)) > 0)
+        for (i = 0; i < n; i++) {
+            if (block[i].svc >= MAX_SVC || block[i].seq >= MAX_SEQ)
+                continue;
+            svc = block[i].svc;
+            seq = block[i].seq;
+            if (seq >= events[svc].cap && grow_events(&events[svc], seq)) {
+                printf("Out of memory reading %s\n", run->path);
+                fclose(in);
+                return -1;
+            }
+            switch (block[i].event) {
+            case TRACE_EV_RELEASE:
+                events[svc].release[seq] = block[i].ts_ns;
+                break;
+            case TRACE_EV_START:
+                events[svc].start[seq] = block[i].ts_ns;
+                break;
+            case TRACE_EV_COMPLETE:
+                events[svc].complete[seq] = block[i].ts_ns;
+                events[svc].exec[seq] = block[i].arg;
+                break;
+            default:
+                break;
+            }
+        }
+    fclose(in);
+
+    for (svc = 0; svc < MAX_SVC; svc++) {
+        svc_events_t *ev = &events[svc];
+
+        have_prev = 0;
+        prev_release = prev_latency = 0;
+        for (seq = skip + 1; seq < ev->cap; seq++) {
+            if (ev->release[seq] != 0 && ev->start[seq] >= ev->release[seq]) {
+                latency = ev->start[seq] - ev->release[seq];
+                push(&run->metric[svc][M_LATENCY], latency);
+                if (have_prev)
+                    push(&run->metric[svc][M_JITTER], fabs((double)latency - (double)prev_latency));
+                prev_latency = latency;
+                have_prev = 1;
+            } else {
+                have_prev = 0;
+            }
+            if (ev->release[seq] != 0 && ev->complete[seq] >= ev->release[seq])
+                push(&run->metric[svc][M_RESPONSE], ev->complete[seq] - ev->release[seq]);
+            if (ev->complete[seq] != 0)
+                push(&run->metric[svc][M_EXEC], ev->exec[seq]);
+
+            if (ev->release[seq] != 0 && prev_release != 0 && ev->release[seq] > prev_release)
+                push(&run->interval[svc], ev->release[seq] - prev_release);
+            prev_release = ev->release[seq];
+        }
+
+        if (run->interval[svc].n > 0)
+            qsort(run->interval[svc].v, run->interval[svc].n, sizeof(double), by_value);
+        for (i = 0; i < NUM_METRICS; i++)
+            if (run->metric[svc][i].n > 0)
+                qsort(run->metric[svc][i].v, run->metric[svc][i].n, sizeof(double), by_value);
+    }
+
+    return 0;
+}
+
+// Release error of every interval against the service's nominal period,
+// after load() of both run and base
+static void release_errors(run_t *run, const run_t *base, int svc) {
+    sample_t *iv = &run->interval[svc];
+    double periods;
+    size_t i;
+
+    if (iv->n == 0)
+        return;
+    if (run->period_ns != 0) {
+        periods = round(percentile(iv, 50) / run->period_ns);
+        run->nominal[svc] = (periods < 1 ? 1 : periods) * run->period_ns;
+    } else if (base->nominal[svc] != 0) {
+        run->nominal[svc] = base->nominal[svc];
+    } else {
+        run->nominal[svc] = percentile(iv, 50);
+    }
+
+    for (i = 0; i < iv->n; i++)
+        push(&run->metric[svc][M_RELEASE], fabs(iv->v[i] - run->nominal[svc]));
+    qsort(run->metric[svc][M_RELEASE].v, run->metric[svc][M_RELEASE].n, sizeof(double), by_value);
+}
+
+// Two-sided p-value of the Mann-Whitney U test, normal approximation with
+// the tie correction. *effect is P(b > a) - P(b < a), Cliff's delta.
+static double mann_whitney(const sample_t *a, const sample_t *b, double *effect) {
+    size_t i = 0, j = 0, k, ties, n1 = a->n, n2 = b->n;
+    double rank = 1, r1 = 0, tie_sum = 0, u1, mean, var, z, v;
+    size_t in_a;
+
+    // Both are sorted, walk them as one merged list, a run of ties at a time
+    while (i < n1 || j < n2) {
+        v = (j >= n2 || (i < n1 && a->v[i] <= b->v[j])) ? a->v[i] : b->v[j];
+        for (in_a = 0; i < n1 && a->v[i] == v; i++)
+            in_a++;
+        for (ties = in_a; j < n2 && b->v[j] == v; j++)
+            ties++;
+        r1 += in_a * (rank + (ties - 1) / 2.0);
+        rank += ties;
+        tie_sum += (double)ties * ties * ties - ties;
+    }
+
+    u1 = r1 - n1 * (n1 + 1) / 2.0;
+    *effect = 1.0 - 2.0 * u1 / ((double)n1 * n2);
+    mean = (double)n1 * n2 / 2.0;
+    k = n1 + n2;
+    var = (double)n1 * n2 / 12.0 * ((k + 1) - tie_sum / ((double)k * (k - 1)));
+    if (var <= 0)
+        return 1.0;
+    z = (fabs(u1 - mean) - 0.5) / sqrt(var);
+    return (z > 0) ? erfc(z / sqrt(2.0)) : 1.0;
+}
+
+// Two-sample Kolmogorov-Smirnov statistic D and its asymptotic p-value
+static double kolmogorov_smirnov(const sample_t *a, const sample_t *b, double *d_out) {
+    size_t i = 0, j = 0;
+    double d = 0, diff, ne, lambda, p = 0, term, v;
+    int k;
+
+    while (i < a->n && j < b->n) {
+        v = (a->v[i] <= b->v[j]) ? a->v[i] : b->v[j];
+        while (i < a->n && a->v[i] == v)
+            i++;
+        while (j < b->n && b->v[j] == v)
+            j++;
+        diff = fabs((double)i / a->n - (double)j / b->n);
+        if (diff > d)
+            d = diff;
+    }
+    *d_out = d;
+
+    ne = (double)a->n * b->n / (a->n + b->n);
+    lambda = (sqrt(ne) + 0.12 + 0.11 / sqrt(ne)) * d;
+    if (lambda < 0.2)
+        return 1.0;
+    for (k = 1; k <= 100; k++) {
+        term = 2.0 * ((k & 1) ? 1 : -1) * exp(-2.0 * k * k * lambda * lambda);
+        p += term;
+        if (fabs(term) < 1e-10)
+            break;
+    }
+    return (p < 0) ? 0 : (p > 1) ? 1 : p;
+}
+
+static double change_pct(double from, double to) {
+    if (from == 0)
+        return (to == 0) ? 0 : 100.0;
+    return 100.0 * (to - from) / from;
+}
+
+// One line per service and metric, returns 1 for a regression
+static int compare(int svc, int m, const sample_t *a, const sample_t *b) {
+    double a50, b50, a99, b99, d50, d99, p_u, p_ks, effect, d;
+    const char *verdict;
+    int significant, worse;
+
+    printf("S%-2d %-8s n %6zu %6zu", svc, metric_names[m], a->n, b->n);
+    if (a->n < MIN_SAMPLES || b->n < MIN_SAMPLES) {
+        printf("  too few to compare\n");
+        return 0;
+    }
+
+    a50 = percentile(a, 50);
+    b50 = percentile(b, 50);
+    a99 = percentile(a, 99);
+    b99 = percentile(b, 99);
+    d50 = change_pct(a50, b50);
+    d99 = change_pct(a99, b99);
+    p_u = mann_whitney(a, b, &effect);
+    p_ks = kolmogorov_smirnov(a, b, &d);
+
+    significant = (p_u < alpha || p_ks < alpha);
+    worse = (d50 > median_pct || d99 > tail_pct);
+    if (significant && worse)
+        verdict = "REGRESSION";
+    else if (significant && (d50 < -median_pct || d99 < -tail_pct))
+        verdict = "better";
+    else if (significant)
+        verdict = "shifted";
+    else
+        verdict = "same";
+
+    printf("  p50 %9.1f -> %9.1f us %+7.1f%%  p99 %9.1f -> %9.1f us %+7.1f%%  U p=%.2g d=%+.2f  KS D=%.2f p=%.2g  %s\n",
+           a50 / 1000.0, b50 / 1000.0, d50, a99 / 1000.0, b99 / 1000.0, d99, p_u, effect, d, p_ks, verdict);
+    return significant && worse;
+}
+
+// Mean interval and cumulative drift from the nominal period, returns 1 for a regression
+static int compare_drift(int svc, const run_t *a, const run_t *b) {
+    const sample_t *ia = &a->interval[svc], *ib = &b->interval[svc];
+    double drift_a, drift_b, ppm_a, ppm_b;
+    const char *verdict;
+    int worse;
+
+    printf("S%-2d %-8s n %6zu %6zu", svc, "drift", ia->n, ib->n);
+    if (ia->n < MIN_SAMPLES || ib->n < MIN_SAMPLES) {
+        printf("  too few to compare\n");
+        return 0;
+    }
+
+    drift_a = sum(ia) - ia->n * a->nominal[svc];
+    drift_b = sum(ib) - ib->n * b->nominal[svc];
+    ppm_a = 1e6 * drift_a / (ia->n * a->nominal[svc]);
+    ppm_b = 1e6 * drift_b / (ib->n * b->nominal[svc]);
+    worse = (fabs(ppm_b) - fabs(ppm_a) > drift_ppm);
+    if (worse)
+        verdict = "REGRESSION";
+    else if (fabs(ppm_a) - fabs(ppm_b) > drift_ppm)
+        verdict = "better";
+    else
+        verdict = "same";
+
+    printf("  mean %9.1f -> %9.1f us  nominal %9.1f -> %9.1f us  cumulative %+10.1f -> %+10.1f us  %+7.0f -> %+7.0f ppm  %s\n",
+           sum(ia) / ia->n / 1000.0, sum(ib) / ib->n / 1000.0, a->nominal[svc] / 1000.0, b->nominal[svc] / 1000.0,
+           drift_a / 1000.0, drift_b / 1000.0, ppm_a, ppm_b, verdict);
+    return worse;
+}
+
+int main(int argc, char *argv[])
+{
+    run_t *runs;
+    int opt, nruns, r, svc, m, regressions = 0;
+
+    while ((opt = getopt(argc, argv, "a:m:t:d:k:p:")) != -1) {
+        switch (opt) {
+        case 'a':
+            alpha = atof(optarg);
+            break;
+        case 'm':
+            median_pct = atof(optarg);
+            break;
+        case 't':
+            tail_pct = atof(optarg);
+            break;
+        case 'd':
+            drift_ppm = atof(optarg);
+            break;
+        case 'k':
+            skip = strtoul(optarg, NULL, 10);
+            break;
+        case 'p':
+            period_ns = strtoull(optarg, NULL, 10) * 1000ULL;
+            break;
+        default:
+            optind = argc;
+            break;
+        }
+    }
+    nruns = argc - optind;
+    if (nruns < 2) {
+        printf("Usage: %s [-a alpha] [-m median_pct] [-t p99_pct] [-d drift_ppm] [-k skip] [-p period_us] base.bin run.bin...\n",
+               argv[0]);
+        return -1;
+    }
+
+    runs = calloc(nruns, sizeof(run_t));
+    if (runs == NULL)
+        return -1;
+    for (r = 0; r < nruns; r++) {
+        runs[r].path = argv[optind + r];
+        if (load(&runs[r]))
+            return -1;
+        for (svc = 0; svc < MAX_SVC; svc++)
+            release_errors(&runs[r], &runs[0], svc);
+    }
+
+    for (r = 1; r < nruns; r++) {
+        printf("%s against %s (alpha %g, worse by over %g%% at p50 or %g%% at p99 or %g ppm of drift, %lu releases skipped)\n",
+               runs[r].path, runs[0].path, alpha, median_pct, tail_pct, drift_ppm, skip);
+        for (svc = 0; svc < MAX_SVC; svc++) {
+            for (m = 0; m < NUM_METRICS; m++)
+                if (runs[0].metric[svc][m].n > 0 || runs[r].metric[svc][m].n > 0)
+                    regressions += compare(svc, m, &runs[0].metric[svc][m], &runs[r].metric[svc][m]);
+            if (runs[0].interval[svc].n > 0 || runs[r].interval[svc].n > 0)
+                regressions += compare_drift(svc, &runs[0], &runs[r]);
+        }
+        printf("\n");
+    }
+
+    printf("%d regressions\n", regressions);
+    return (regressions > 0) ? 1 : 0;
+}
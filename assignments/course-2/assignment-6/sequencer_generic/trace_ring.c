@@ -0,0 +1,482 @@
+/**
+ * File: trace_ring.c
+ * Author: Brad Waggle
+ * Description: Per-thread binary trace rings drained to a file by a
+ *              best-effort thread.
+ * Date: October 18, 2026
+ */
+
+// The in-memory event logger the seqgenex0.c header asks for instead of
+// printf and syslog in the services. Each thread that logs takes its own
+// ring once with trace_thread_init(), so trace_event() needs no lock and
+// no atomic read-modify-write: it reads the clock and the core (both vDSO
+// or rseq, no system call), fills a 32 byte record and publishes it with
+// one release store. When the ring is full the record is dropped and
+// counted, the service never waits for the drain.
+//
+// The drain thread runs SCHED_OTHER on the cores the RT services are not
+// pinned to, like the offload workers, and writes whatever each ring holds
+// every TRACE_DRAIN_PERIOD_US. All rings are reserved, touched and locked
+// in trace_start().
+//
+// trace_marker_open() also mirrors release, start, complete and miss
+// events into ftrace through tracefs trace_marker, so they sit in the same
+// timeline as the kernel's sched_switch and irq events. The markers use the
+// systrace text form that Perfetto and trace-cmd already understand:
+// "B|pid|S1 42" opens a slice for release 42 of S1, "E|pid" closes it and
+// "I|pid|S1 release 42" is an instant. marker_latency.c reads them back.
+// Each marker is one write() system call, about a microsecond, so this is
+// for runs that chase a late release, not the default.
+//
+// trace_flight_start() runs the same rings as a flight recorder for runs
+// too long to trace to a file. The rings overwrite their oldest record
+// instead of dropping, nothing is written out and trace_event() costs no
+// more than before. A deadline miss, sequencer overrun or budget overrun
+// event claims a snapshot with one compare-and-swap and leaves the rest to
+// the drain thread. Logging never stops: at its next wake-up the drain
+// thread copies every ring from TRACE_FLIGHT_WINDOW_MS before the trigger
+// up to its head at that moment, so the events right after the trigger
+// are kept too, and writes the copy as a trace file trace2chrome can read.
+// Records overwritten while they were copied are trimmed by checking the
+// head again afterwards, as a seqlock reader does. Triggers that land
+// before the copy are in it and only counted.
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/sysinfo.h>
+#include "trace_ring.h"
+#include "rt_time.h"
+#include "rt_cycles.h"
+
+#ifdef TRACE_CYCLES
+// Calibrated cycle counter, on the CLOCK_MONOTONIC time line, a few ns a record
+#define trace_now() rt_cycles_now()
+#else
+#define trace_now() rt_time_mono()
+#endif
+
+static trace_ring_t rings[TRACE_MAX_THREADS];
+static atomic_int num_rings;
+static trace_record_t *store;       // TRACE_MAX_THREADS rings of records
+static int trace_fd = -1;
+static pthread_t drain_thread;
+static atomic_int draining;
+static unsigned long long written;
+
+static unsigned long long start_ns;
+static unsigned int period_ns;          // written to the header for trace_cmp
+
+static __thread trace_ring_t *my_ring;
+
+// Flight recorder, on when started with trace_flight_start()
+static int flight;
+static char flight_prefix[64];
+static trace_record_t *snapshot;    // what the rings held when copied
+static atomic_int triggered;        // FLIGHT_* state of the next snapshot
+static trace_record_t trigger;
+static atomic_int snapshots;
+static atomic_ullong last_trigger_ns;
+static atomic_ullong covered;       // triggers that landed in a snapshot not copied yet
+static atomic_ullong ignored;       // triggers in hold-off or over the limit
+
+#define FLIGHT_IDLE (0)
+#define FLIGHT_CLAIMED (1)          // a thread is filling in the trigger
+#define FLIGHT_READY (2)            // trigger filled in, the drain thread copies next
+
+// ftrace markers, off unless trace_marker_open() succeeded
+static int marker_fd = -1;
+static int marker_pid;
+static atomic_ullong marker_errors;
+
+// Write out everything a ring holds, at most two write() calls for the wrap
+static void drain_ring(trace_ring_t *ring) {
+    unsigned long tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned long head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    unsigned long start, count;
+    ssize_t rc;
+
+    while (tail != head) {
+        start = tail & TRACE_RING_MASK;
+        count = head - tail;
+        if (start + count > TRACE_RING_RECORDS)
+            count = TRACE_RING_RECORDS - start;
+
+        rc = write(trace_fd, &ring->records[start], count * sizeof(trace_record_t));
+        if (rc < 0) {
+            perror("trace write");
+            break;                          // records stay queued, the owner drops once full
+        }
+
+        // A short write leaves the rest for the next pass
+        count = rc / sizeof(trace_record_t);
+        tail += count;
+        written += count;
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+        if (count == 0)
+            break;
+    }
+}
+
+static void drain_all(void) {
+    int i, n = atomic_load_explicit(&num_rings, memory_order_acquire);
+
+    for (i = 0; i < n; i++)
+        drain_ring(&rings[i]);
+}
+
+// Events that make the flight recorder take a snapshot
+static inline int is_trigger(int event) {
+    return event == TRACE_EV_DEADLINE_MISS || event == TRACE_EV_OVERRUN || event == TRACE_EV_BUDGET;
+}
+
+static const char *trigger_name(int event) {
+    switch (event) {
+    case TRACE_EV_DEADLINE_MISS:
+        return "deadline miss";
+    case TRACE_EV_OVERRUN:
+        return "sequencer overrun";
+    case TRACE_EV_BUDGET:
+        return "budget overrun";
+    default:
+        return "trigger";
+    }
+}
+
+static int by_time(const void *a, const void *b) {
+    uint64_t x = ((const trace_record_t *)a)->ts_ns, y = ((const trace_record_t *)b)->ts_ns;
+
+    return (x > y) - (x < y);
+}
+
+// Ask the drain thread for a snapshot, called by the thread that logged rec
+static void flight_trigger(const trace_record_t *rec) {
+    int expected = FLIGHT_IDLE;
+
+    // rec is published. Either the drain thread has not started the pending
+    // copy and will see rec, or this thread sees FLIGHT_IDLE.
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&triggered, memory_order_relaxed) != FLIGHT_IDLE) {
+        atomic_fetch_add_explicit(&covered, 1, memory_order_relaxed);
+        return;
+    }
+
+    if (atomic_load_explicit(&snapshots, memory_order_relaxed) >= TRACE_FLIGHT_MAX_SNAPSHOTS ||
+        rec->ts_ns - atomic_load_explicit(&last_trigger_ns, memory_order_relaxed) <
+            TRACE_FLIGHT_HOLDOFF_MS * 1000000ULL) {
+        atomic_fetch_add_explicit(&ignored, 1, memory_order_relaxed);
+        return;
+    }
+    if (!atomic_compare_exchange_strong(&triggered, &expected, FLIGHT_CLAIMED)) {
+        atomic_fetch_add_explicit(&covered, 1, memory_order_relaxed);
+        return;
+    }
+
+    trigger = *rec;
+    atomic_store_explicit(&last_trigger_ns, rec->ts_ns, memory_order_relaxed);
+    atomic_store_explicit(&triggered, FLIGHT_READY, memory_order_release);
+}
+
+// Copy the rings while they keep logging, from the window before the trigger
+// to their heads now, and write the copy to a file
+static void flight_snapshot(void) {
+    trace_file_header_t header = { TRACE_MAGIC, sizeof(trace_record_t), period_ns, start_ns };
+    trace_record_t at = trigger;
+    unsigned long long from_ns = at.ts_ns - TRACE_FLIGHT_WINDOW_MS * 1000000ULL;
+    unsigned long head, recheck, first, valid, i;
+    size_t count = 0, base, size;
+    trace_ring_t *ring;
+    char path[96];
+    int r, fd, n = atomic_load_explicit(&num_rings, memory_order_acquire);
+
+    // Later triggers start the next snapshot, unless they land in this copy
+    atomic_store_explicit(&triggered, FLIGHT_IDLE, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    for (r = 0; r < n; r++) {
+        ring = &rings[r];
+        head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        first = (head > TRACE_RING_RECORDS) ? head - TRACE_RING_RECORDS : 0;
+        base = count;
+        for (i = first; i < head; i++)
+            snapshot[base + (i - first)] = ring->records[i & TRACE_RING_MASK];
+
+        // The owner keeps logging, it may have overwritten the oldest
+        // records while they were copied
+        atomic_thread_fence(memory_order_acquire);
+        recheck = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        valid = (recheck >= TRACE_RING_RECORDS) ? recheck - TRACE_RING_RECORDS + 1 : 0;
+
+        for (i = (valid > first) ? valid : first; i < head; i++)
+            if (snapshot[base + (i - first)].ts_ns >= from_ns)
+                snapshot[count++] = snapshot[base + (i - first)];
+    }
+
+    qsort(snapshot, count, sizeof(trace_record_t), by_time);
+
+    r = atomic_fetch_add(&snapshots, 1) + 1;
+    snprintf(path, sizeof(path), "%s-%d.bin", flight_prefix, r);
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror("flight snapshot open");
+        return;
+    }
+    size = count * sizeof(trace_record_t);
+    if (write(fd, &header, sizeof(header)) != sizeof(header) || write(fd, snapshot, size) != (ssize_t)size)
+        perror("flight snapshot write");
+    close(fd);
+
+    printf("Flight recorder: %s of S%d release %llu, %zu records to %s\n", trigger_name(at.event),
+           at.svc, (unsigned long long)at.seq, count, path);
+}
+
+static void *drain_worker(void *arg) {
+    while (atomic_load(&draining)) {
+        usleep(TRACE_DRAIN_PERIOD_US);
+        if (!flight)
+            drain_all();
+        else if (atomic_load_explicit(&triggered, memory_order_acquire) == FLIGHT_READY)
+            flight_snapshot();
+    }
+
+    return NULL;
+}
+
+static int reserve_rings(void) {
+    size_t size = sizeof(trace_record_t) * TRACE_RING_RECORDS * TRACE_MAX_THREADS;
+    int i;
+
+    if (posix_memalign((void **)&store, sysconf(_SC_PAGESIZE), size) != 0) {
+        printf("Failed to reserve trace rings\n");
+        return -1;
+    }
+    memset(store, 0, size);
+    if (mlock(store, size) != 0)
+        perror("trace mlock");
+
+    memset(rings, 0, sizeof(rings));
+    for (i = 0; i < TRACE_MAX_THREADS; i++)
+        rings[i].records = store + (i * TRACE_RING_RECORDS);
+    atomic_store(&num_rings, 0);
+#ifdef TRACE_CYCLES
+    if (rt_cycles_init())
+        printf("No invariant cycle counter, trace times from clock_gettime\n");
+#endif
+    start_ns = trace_now();
+
+    return 0;
+}
+
+// Start the drain thread on the non-RT cores
+static int start_drain(const cpu_set_t *rt_cpus) {
+    pthread_attr_t attr;
+    struct sched_param param;
+    cpu_set_t drain_cpus;
+    int i, rc;
+
+    CPU_ZERO(&drain_cpus);
+    for (i = 0; i < get_nprocs(); i++)
+        if (rt_cpus == NULL || !CPU_ISSET(i, rt_cpus))
+            CPU_SET(i, &drain_cpus);
+    if (CPU_COUNT(&drain_cpus) == 0)
+        for (i = 0; i < get_nprocs(); i++)
+            CPU_SET(i, &drain_cpus);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+    param.sched_priority = 0;
+    pthread_attr_setschedparam(&attr, &param);
+    pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &drain_cpus);
+
+    atomic_store(&draining, 1);
+    rc = pthread_create(&drain_thread, &attr, drain_worker, NULL);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        printf("pthread_create for trace drain failed: %s\n", strerror(rc));
+        return -1;
+    }
+
+    return 0;
+}
+
+// Reserve the rings, open the file and start the drain thread
+int trace_start(const char *path, unsigned int period, const cpu_set_t *rt_cpus) {
+    trace_file_header_t header = { TRACE_MAGIC, sizeof(trace_record_t), period, 0 };
+
+    if (reserve_rings())
+        return -1;
+
+    header.start_ns = start_ns;
+    trace_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (trace_fd < 0 || write(trace_fd, &header, sizeof(header)) != sizeof(header)) {
+        perror("trace open");
+        return -1;
+    }
+
+    return start_drain(rt_cpus);
+}
+
+// Reserve the rings as a flight recorder, snapshots go to prefix-N.bin
+int trace_flight_start(const char *prefix, unsigned int period, const cpu_set_t *rt_cpus) {
+    size_t size = sizeof(trace_record_t) * TRACE_RING_RECORDS * TRACE_MAX_THREADS;
+
+    if (reserve_rings())
+        return -1;
+
+    // Touched now so the first snapshot does not fault it in
+    snapshot = malloc(size);
+    if (snapshot == NULL) {
+        printf("Failed to reserve the flight recorder snapshot\n");
+        return -1;
+    }
+    memset(snapshot, 0, size);
+
+    snprintf(flight_prefix, sizeof(flight_prefix), "%s", prefix);
+    period_ns = period;
+    flight = 1;
+
+    return start_drain(rt_cpus);
+}
+
+// Open tracefs trace_marker once, trace_event() then mirrors its events there
+int trace_marker_open(void) {
+    static const char *paths[] = { "/sys/kernel/tracing/trace_marker", "/sys/kernel/debug/tracing/trace_marker" };
+    unsigned int i;
+
+    for (i = 0; i < sizeof(paths) / sizeof(paths[0]) && marker_fd < 0; i++)
+        marker_fd = open(paths[i], O_WRONLY | O_CLOEXEC);
+    if (marker_fd < 0) {
+        perror("trace_marker open");
+        return -1;
+    }
+
+    marker_pid = getpid();
+    return 0;
+}
+
+// One systrace-style marker per event, one write() each
+static void write_marker(trace_event_t event, int svc, unsigned long long seq) {
+    char buf[64];
+    int len;
+
+    switch (event) {
+    case TRACE_EV_RELEASE:
+        len = snprintf(buf, sizeof(buf), "I|%d|S%d release %llu", marker_pid, svc, seq);
+        break;
+    case TRACE_EV_START:
+        len = snprintf(buf, sizeof(buf), "B|%d|S%d %llu", marker_pid, svc, seq);
+        break;
+    case TRACE_EV_COMPLETE:
+        len = snprintf(buf, sizeof(buf), "E|%d", marker_pid);
+        break;
+    case TRACE_EV_DEADLINE_MISS:
+        len = snprintf(buf, sizeof(buf), "I|%d|S%d miss %llu", marker_pid, svc, seq);
+        break;
+    default:
+        return;
+    }
+
+    if (write(marker_fd, buf, len) != len)
+        atomic_fetch_add_explicit(&marker_errors, 1, memory_order_relaxed);
+}
+
+// Give the calling thread its own ring, call once before its first trace_event()
+int trace_thread_init(const char *name) {
+    int idx = atomic_fetch_add(&num_rings, 1);
+
+    if (idx >= TRACE_MAX_THREADS) {
+        atomic_fetch_sub(&num_rings, 1);
+        printf("No trace ring left for %s\n", name);
+        return -1;
+    }
+
+    rings[idx].name = name;
+    my_ring = &rings[idx];
+
+    return 0;
+}
+
+// Log one event from the calling thread, a no-op if it has no ring
+void trace_event(trace_event_t event, int svc, unsigned long long seq, unsigned long long arg) {
+    trace_ring_t *ring = my_ring;
+    trace_record_t *rec;
+    unsigned long head;
+
+    if (marker_fd >= 0)
+        write_marker(event, svc, seq);
+
+    if (ring == NULL)
+        return;
+
+    // A flight recorder ring overwrites its oldest record, even while a snapshot is copied
+    head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (!flight && head - ring->cached_tail >= TRACE_RING_RECORDS) {
+        ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head - ring->cached_tail >= TRACE_RING_RECORDS) {
+            ring->dropped++;
+            return;
+        }
+    }
+
+    rec = &ring->records[head & TRACE_RING_MASK];
+    rec->ts_ns = trace_now();
+    rec->event = event;
+    rec->svc = svc;
+    rec->cpu = sched_getcpu();
+    rec->seq = seq;
+    rec->arg = arg;
+
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    if (flight && is_trigger(event))
+        flight_trigger(rec);
+}
+
+// Stop the drain thread and write out what is left, call after the logging threads are joined.
+// trace_report() still works afterwards.
+void trace_stop(void) {
+    atomic_store(&draining, 0);
+    pthread_join(drain_thread, NULL);
+    if (!flight)
+        drain_all();
+    else if (atomic_load(&triggered) == FLIGHT_READY)
+        flight_snapshot();
+
+    if (trace_fd >= 0)
+        close(trace_fd);
+    trace_fd = -1;
+    if (marker_fd >= 0)
+        close(marker_fd);
+    marker_fd = -1;
+
+    munlock(store, sizeof(trace_record_t) * TRACE_RING_RECORDS * TRACE_MAX_THREADS);
+    free(store);
+    store = NULL;
+    free(snapshot);
+    snapshot = NULL;
+}
+
+void trace_report(void) {
+    int i, n = atomic_load(&num_rings);
+
+    if (flight)
+        printf("Flight recorder: %d snapshots from %d threads, %llu more triggers inside them, %llu ignored\n",
+               atomic_load(&snapshots), n, atomic_load(&covered), atomic_load(&ignored));
+    else
+        printf("Trace: %llu records written from %d threads\n", written, n);
+    if (marker_pid != 0)
+        printf("  ftrace markers for pid %d, %llu failed writes\n", marker_pid, atomic_load(&marker_errors));
+#ifdef TRACE_CYCLES
+    rt_cycles_report();
+#endif
+    for (i = 0; i < n; i++)
+        printf("  %-12s logged=%lu dropped=%llu\n", rings[i].name,
+               atomic_load(&rings[i].head), rings[i].dropped);
+}
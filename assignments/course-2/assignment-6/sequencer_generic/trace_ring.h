@@ -0,0 +1,82 @@
+#ifndef TRACE_RING_H
+#define TRACE_RING_H
+
+// cpu_set_t needs _GNU_SOURCE defined before the first system include
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+// Records per thread ring, must be a power of 2
+#define TRACE_RING_RECORDS (4096)
+#define TRACE_RING_MASK (TRACE_RING_RECORDS - 1)
+
+// Threads that can log, each takes one ring for good
+#define TRACE_MAX_THREADS (16)
+
+// How often the drain thread empties the rings
+#define TRACE_DRAIN_PERIOD_US (10000)
+
+#define TRACE_MAGIC "SEQTRC1"
+
+// Flight recorder snapshots: how far back they reach from the trigger, how
+// soon after one another they may be taken and how many one run writes
+#define TRACE_FLIGHT_WINDOW_MS (500)
+#define TRACE_FLIGHT_HOLDOFF_MS (1000)
+#define TRACE_FLIGHT_MAX_SNAPSHOTS (16)
+
+// Event ids
+typedef enum
+{
+    TRACE_EV_RELEASE = 1,           // sequencer released the service
+    TRACE_EV_START,                 // service started the release
+    TRACE_EV_COMPLETE,              // service finished the release, arg is execution time in ns
+    TRACE_EV_PREEMPTED,             // release saw involuntary switches, arg is how many
+    TRACE_EV_MARK,                  // free-form, arg is up to the caller
+    TRACE_EV_DEADLINE_MISS,         // release seq was not done by the next release (D=T)
+    TRACE_EV_OVERRUN,               // sequencer cycle ran past its period, arg is ns over
+    TRACE_EV_BUDGET                 // release ran past its execution budget, arg is execution time in ns
+} trace_event_t;
+
+// One fixed-size binary record, 32 bytes
+typedef struct
+{
+    uint64_t ts_ns;                 // CLOCK_MONOTONIC
+    uint16_t event;                 // trace_event_t
+    uint16_t svc;                   // service id, 0 is the sequencer
+    uint32_t cpu;
+    uint64_t seq;                   // release number of the service
+    uint64_t arg;
+} trace_record_t;
+
+// File starts with this header, followed by records. Records are in order
+// per thread but threads are interleaved a drain period at a time. Flight
+// recorder snapshots use the same layout, sorted by time.
+typedef struct
+{
+    char magic[8];                  // TRACE_MAGIC
+    uint32_t record_size;           // sizeof(trace_record_t)
+    uint32_t period_ns;             // sequencer period, 0 in traces from before it was recorded
+    uint64_t start_ns;              // CLOCK_MONOTONIC time trace_start() was called
+} trace_file_header_t;
+
+// Single producer (the owning thread), single consumer (the drain thread)
+typedef struct
+{
+    const char *name;
+    trace_record_t *records;
+    _Alignas(64) atomic_ulong head;         // next record the owner writes
+    unsigned long cached_tail;              // owner's copy of tail, refreshed when it looks full
+    unsigned long long dropped;             // records lost because the ring was full
+    _Alignas(64) atomic_ulong tail;         // next record the drain thread writes out
+} trace_ring_t;
+
+int trace_start(const char *path, unsigned int period_ns, const cpu_set_t *rt_cpus);
+int trace_flight_start(const char *prefix, unsigned int period_ns, const cpu_set_t *rt_cpus);
+int trace_thread_init(const char *name);
+int trace_marker_open(void);
+void trace_event(trace_event_t event, int svc, unsigned long long seq, unsigned long long arg);
+void trace_stop(void);
+void trace_report(void);
+
+#endif